@@ -0,0 +1,187 @@
+#ifndef BOUNDED_BUFFER_H
+#define BOUNDED_BUFFER_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+struct BufferStats {
+    uint64_t puts = 0;  // items
+    uint64_t takes = 0;
+    uint64_t fullWaitNs = 0;  // producers blocked on a full buffer
+    uint64_t emptyWaitNs = 0;  // consumers blocked on an empty buffer
+    uint64_t depthSamples = 0;  // one per take, of the items it found in the buffer
+    uint64_t depthSum = 0;
+    size_t maxDepth = 0;
+
+    double meanDepth() const { return depthSamples == 0 ? 0.0 : static_cast<double>(depthSum) / depthSamples; }
+};
+
+
+// Reusable bounded buffer on the same design as the carts of multiple_buffers.cpp (which keep
+// their own code): a ring of fixed capacity, a mutex, and condition variables producers wait on
+// while it is full and consumers while it is empty.
+//
+// On top of that it can be closed, so a stage knows when its input has ended, it moves items in
+// batches (one lock acquisition and one wakeup per batch instead of per item), and it records how
+// long producers and consumers were blocked and how full it was, for finding the slow stage of a
+// pipeline. A buffer with several producers closes when the last of them calls producerDone().
+//
+// Lock can be any mutex type (e.g. CohortLock from Common/numa_lock.h, waited on through
+// std::condition_variable_any), and Allocator places the ring, e.g. NodeAllocator from
+// Common/numa.h to keep it on the consumer's NUMA node
+template <typename T, typename Lock = std::mutex, typename Allocator = std::allocator<T>>
+class BoundedBuffer {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit BoundedBuffer(size_t capacity, int producers = 1, const Allocator &allocator = Allocator())
+        : ring(capacity > 0 ? capacity : 1, allocator), producers(producers) {}
+
+    // Blocks while the buffer is full. Returns false if the buffer was closed
+    bool put(T item) {
+        std::unique_lock<Lock> lock(mutex);
+        waitFor(lock, notFull, stats.fullWaitNs, [this] { return count < ring.size() || closed; });
+        if (closed)
+            return false;
+        push(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Put every item, blocking for space as needed; consumers are woken once per chunk that fits
+    bool putBatch(std::vector<T> &items) {
+        size_t next = 0;
+        while (next < items.size()) {
+            std::unique_lock<Lock> lock(mutex);
+            waitFor(lock, notFull, stats.fullWaitNs, [this] { return count < ring.size() || closed; });
+            if (closed)
+                return false;
+            size_t n = std::min(ring.size() - count, items.size() - next);
+            for (size_t i = 0; i < n; i++)
+                push(std::move(items[next++]));
+            lock.unlock();
+            if (n > 1)
+                notEmpty.notify_all();
+            else
+                notEmpty.notify_one();
+        }
+        items.clear();
+        return true;
+    }
+
+    // Blocks while the buffer is empty. Returns false once it is closed and drained
+    bool take(T &item) {
+        std::unique_lock<Lock> lock(mutex);
+        waitFor(lock, notEmpty, stats.emptyWaitNs, [this] { return count > 0 || closed; });
+        if (count == 0)
+            return false;
+        sampleDepth();
+        item = pop();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Take up to max items into items (cleared first). Returns false once closed and drained
+    bool takeBatch(std::vector<T> &items, size_t max) {
+        items.clear();
+        std::unique_lock<Lock> lock(mutex);
+        waitFor(lock, notEmpty, stats.emptyWaitNs, [this] { return count > 0 || closed; });
+        if (count == 0)
+            return false;
+        sampleDepth();
+        while (count > 0 && items.size() < max)
+            items.emplace_back(pop());
+        lock.unlock();
+        if (items.size() > 1)
+            notFull.notify_all();
+        else
+            notFull.notify_one();
+        return true;
+    }
+
+    // Wake everyone; puts fail from now on, takes drain what is left
+    void close() {
+        std::lock_guard<Lock> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    void producerDone() {
+        std::lock_guard<Lock> lock(mutex);
+        if (--producers <= 0) {
+            closed = true;
+            notFull.notify_all();
+            notEmpty.notify_all();
+        }
+    }
+
+    size_t capacity() const { return ring.size(); }
+
+    size_t size() {
+        std::lock_guard<Lock> lock(mutex);
+        return count;
+    }
+
+    BufferStats statistics() {
+        std::lock_guard<Lock> lock(mutex);
+        return stats;
+    }
+
+private:
+    typedef typename std::conditional<std::is_same<Lock, std::mutex>::value, std::condition_variable,
+                                      std::condition_variable_any>::type Condition;
+
+    template <typename Predicate>
+    void waitFor(std::unique_lock<Lock> &lock, Condition &cv, uint64_t &waitedNs,
+                 Predicate ready) {
+        if (ready())
+            return;
+        auto start = Clock::now();
+        cv.wait(lock, ready);
+        waitedNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    void push(T item) {
+        size_t tail = head + count;
+        ring[tail >= ring.size() ? tail - ring.size() : tail] = std::move(item);
+        count++;
+        stats.puts++;
+    }
+
+    T pop() {
+        T item = std::move(ring[head]);
+        head = (head + 1 == ring.size()) ? 0 : head + 1;
+        count--;
+        stats.takes++;
+        return item;
+    }
+
+    void sampleDepth() {
+        stats.depthSamples++;
+        stats.depthSum += count;
+        if (count > stats.maxDepth)
+            stats.maxDepth = count;
+    }
+
+    Lock mutex;
+    Condition notEmpty;
+    Condition notFull;
+    std::vector<T, Allocator> ring;
+    size_t head = 0;
+    size_t count = 0;
+    int producers;
+    bool closed = false;
+    BufferStats stats;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cstdlib>
+#include "bounded_buffer.h"
+#include "elastic_buffer.h"
+#include "../Common/perf_counters.h"
+
+
+// Memory against producer throttling for a large set of queues of which only a few are busy, with
+// every queue a fixed BoundedBuffer of the cart size, a fixed BoundedBuffer big enough for the
+// bursts, or an ElasticBuffer:
+//
+//  - each of the --hot queues has a producer putting --burst items back to back every --gap-ms
+//    and a consumer spending --consume-ns per item, so bursts have to be absorbed or throttled
+//  - one thread trickles an item through a random idle queue every --idle-us
+//  - a housekeeping thread calls adapt() on every elastic queue once a window and samples the
+//    storage all queues hold
+//
+//   elastic_benchmark [--queues Q] [--hot H] [--seconds S] [--burst B] [--gap-ms G]
+//                     [--consume-ns N] [--idle-us U] [--mode fixed_small|fixed_large|elastic|all]
+//
+// producer_wait_pct is the share of the hot producers' time spent waiting on a full queue. Rows
+// end with hardware counters for the run and per item
+
+const size_t CART_SIZE = 10;  // what every cart holds today
+
+typedef std::chrono::steady_clock Clock;
+typedef BoundedBuffer<uint64_t> FixedQueue;
+typedef ElasticBuffer<uint64_t> ElasticQueue;
+
+struct Config {
+    int queues = 1000;
+    int hot = 4;
+    int seconds = 2;
+    int burst = 2000;
+    int gapMs = 20;
+    int consumeNs = 500;
+    int idleUs = 100;
+    ElasticPolicy policy;
+};
+
+std::atomic<bool> stopFlag(false);
+
+
+size_t storageBytes(FixedQueue &queue, const Config &) {
+    return queue.capacity() * sizeof(uint64_t);
+}
+
+size_t storageBytes(ElasticQueue &queue, const Config &config) {
+    return queue.elasticity().segments * config.policy.segmentItems * sizeof(uint64_t);
+}
+
+void adapt(FixedQueue &) {}
+
+void adapt(ElasticQueue &queue) {
+    queue.adapt();
+}
+
+ElasticStats elasticity(FixedQueue &queue) {
+    ElasticStats stats;
+    stats.capacity = queue.capacity();
+    return stats;
+}
+
+ElasticStats elasticity(ElasticQueue &queue) {
+    return queue.elasticity();
+}
+
+
+void spinFor(int ns) {
+    auto until = Clock::now() + std::chrono::nanoseconds(ns);
+    while (Clock::now() < until)
+        ;
+}
+
+template <typename Queue>
+void runMode(const std::string &mode, const std::function<Queue *()> &make, const Config &config) {
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (int q = 0; q < config.queues; q++)
+        queues.emplace_back(make());
+
+    std::vector<std::thread> threads;
+    std::vector<uint64_t> consumed(config.hot, 0);
+    size_t peakBytes = 0;
+    PerfCounters counters;
+
+    stopFlag = false;
+    counters.start();
+    auto start = Clock::now();
+    for (int h = 0; h < config.hot; h++) {
+        Queue &queue = *queues[h];
+        threads.emplace_back([&] {
+            for (uint64_t i = 0; !stopFlag.load(std::memory_order_relaxed); ) {
+                for (int b = 0; b < config.burst; b++)
+                    queue.put(i++);
+                std::this_thread::sleep_for(std::chrono::milliseconds(config.gapMs));
+            }
+            queue.producerDone();
+        });
+        threads.emplace_back([&, h] {
+            uint64_t item;
+            while (queue.take(item)) {
+                consumed[h]++;
+                spinFor(config.consumeNs);
+            }
+        });
+    }
+
+    // Idle queues see one item now and then, taken right back
+    threads.emplace_back([&] {
+        int idle = config.queues - config.hot;
+        for (unsigned seed = 1; idle > 0 && !stopFlag.load(std::memory_order_relaxed); ) {
+            Queue &queue = *queues[config.hot + rand_r(&seed) % idle];
+            uint64_t item;
+            queue.put(0);
+            queue.take(item);
+            std::this_thread::sleep_for(std::chrono::microseconds(config.idleUs));
+        }
+    });
+
+    std::thread housekeeping([&] {
+        while (!stopFlag.load(std::memory_order_relaxed)) {
+            size_t bytes = 0;
+            for (std::unique_ptr<Queue> &queue : queues) {
+                adapt(*queue);
+                bytes += storageBytes(*queue, config);
+            }
+            peakBytes = std::max(peakBytes, bytes);
+            std::this_thread::sleep_for(config.policy.window);
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::seconds(config.seconds));
+    stopFlag = true;
+    for (std::thread &thread : threads)
+        thread.join();
+    housekeeping.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    PerfSample perf = counters.stop();
+
+    uint64_t items = 0;
+    uint64_t producerWaitNs = 0;
+    size_t maxHotCapacity = 0;
+    for (int h = 0; h < config.hot; h++) {
+        items += consumed[h];
+        producerWaitNs += queues[h]->statistics().fullWaitNs;
+        maxHotCapacity = std::max(maxHotCapacity, elasticity(*queues[h]).capacity);
+    }
+    size_t endBytes = 0;
+    uint64_t grows = 0, shrinks = 0;
+    for (std::unique_ptr<Queue> &queue : queues) {
+        endBytes += storageBytes(*queue, config);
+        ElasticStats stats = elasticity(*queue);
+        grows += stats.grows;
+        shrinks += stats.shrinks;
+    }
+
+    std::cout << mode << ',' << config.queues << ',' << config.hot << ',' << items << ',' << seconds << ','
+              << static_cast<uint64_t>(items / seconds) << ','
+              << (config.hot > 0 ? 100.0 * producerWaitNs / (config.hot * seconds * 1e9) : 0.0) << ','
+              << endBytes / 1024 << ',' << peakBytes / 1024 << ',' << maxHotCapacity << ',' << grows << ','
+              << shrinks << perf.csv(items) << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+    Config config;
+    std::string mode = "all";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--queues") config.queues = atoi(argv[i + 1]);
+        else if (option == "--hot") config.hot = atoi(argv[i + 1]);
+        else if (option == "--seconds") config.seconds = atoi(argv[i + 1]);
+        else if (option == "--burst") config.burst = atoi(argv[i + 1]);
+        else if (option == "--gap-ms") config.gapMs = atoi(argv[i + 1]);
+        else if (option == "--consume-ns") config.consumeNs = atoi(argv[i + 1]);
+        else if (option == "--idle-us") config.idleUs = atoi(argv[i + 1]);
+        else if (option == "--mode") mode = argv[i + 1];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--queues Q] [--hot H] [--seconds S] [--burst B] [--gap-ms G]"
+                      << " [--consume-ns N] [--idle-us U] [--mode fixed_small|fixed_large|elastic|all]\n";
+            return 1;
+        }
+    }
+    if (config.queues < 1 || config.hot < 0 || config.hot > config.queues || config.seconds < 1 ||
+        config.burst < 1 || config.gapMs < 0 || config.consumeNs < 0 || config.idleUs < 0) {
+        std::cerr << "Need 0 <= hot <= queues, queues, seconds and burst >= 1\n";
+        return 1;
+    }
+
+    // The large fixed size is what the elastic queues may grow to
+    size_t large = config.policy.maxCapacity;
+    std::cout << "mode,queues,hot,items,seconds,items_per_s,producer_wait_pct,end_kb,peak_kb,max_hot_capacity,grows,"
+                 "shrinks" << perfCsvHeader() << '\n';
+    if (mode == "fixed_small" || mode == "all")
+        runMode<FixedQueue>("fixed_" + std::to_string(CART_SIZE), [] { return new FixedQueue(CART_SIZE); }, config);
+    if (mode == "fixed_large" || mode == "all")
+        runMode<FixedQueue>("fixed_" + std::to_string(large), [large] { return new FixedQueue(large); }, config);
+    if (mode == "elastic" || mode == "all")
+        runMode<ElasticQueue>("elastic", [&config] { return new ElasticQueue(config.policy); }, config);
+}
@@ -0,0 +1,257 @@
+#ifndef ELASTIC_BUFFER_H
+#define ELASTIC_BUFFER_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "bounded_buffer.h"
+
+
+// When and how far an ElasticBuffer resizes. Decisions are made once per window from what the
+// buffer saw during it: the share of puts that found it full and had to wait, the share of takes
+// that found it empty, and the deepest it got
+struct ElasticPolicy {
+    size_t minCapacity = 8;
+    size_t maxCapacity = 4096;
+    size_t segmentItems = 64;  // storage grows and shrinks in segments of this many items
+    std::chrono::milliseconds window{10};
+    double growAt = 0.01;  // double the capacity when at least this share of puts waited
+    double shrinkAt = 0.5;  // halve it when no put waited and at least this share of takes did
+};
+
+
+struct ElasticStats {
+    size_t capacity = 0;
+    size_t segments = 0;  // allocated, including the spare
+    uint64_t grows = 0;
+    uint64_t shrinks = 0;
+};
+
+
+// Bounded buffer whose capacity adapts to its traffic within [minCapacity, maxCapacity], so many
+// mostly idle queues stay small while busy ones grow to absorb bursts instead of throttling their
+// producers.
+//
+// Items live in a chain of fixed-size segments: puts append a segment when the last one fills up,
+// takes release the first one once they have read past its end (one emptied segment is kept as a
+// spare to avoid allocator churn at a boundary). Capacity is only the limit producers wait
+// against, so a resize is a constant-time change of that limit made under the lock by whichever
+// operation closes a window: nothing is copied, no operation waits for it, and memory follows
+// the items actually held rather than the capacity. When the capacity shrinks below the current
+// contents, those items stay and producers wait until consumers have drained below the new limit.
+//
+// Idle buffers close no windows on their own; a housekeeping thread can call adapt() on them
+// periodically, and a window that shrinks an empty buffer frees its last segment too. Statistics
+// have the meaning of BoundedBuffer's
+template <typename T>
+class ElasticBuffer {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit ElasticBuffer(const ElasticPolicy &policy = ElasticPolicy(), int producers = 1)
+        : policy(normalized(policy)), limit(this->policy.minCapacity), producers(producers),
+          windowStart(Clock::now()) {}
+
+    // Blocks while the buffer is full. Returns false if the buffer was closed
+    bool put(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (count >= limit && !closed) {
+            window.fullWaits++;
+            waitFor(lock, notFull, stats.fullWaitNs, [this] { return count < limit || closed; });
+        }
+        if (closed)
+            return false;
+        push(std::move(item));
+        window.puts++;
+        maybeAdapt();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks while the buffer is empty. Returns false once it is closed and drained
+    bool take(T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (count == 0 && !closed) {
+            window.emptyWaits++;
+            waitFor(lock, notEmpty, stats.emptyWaitNs, [this] { return count > 0 || closed; });
+        }
+        if (count == 0)
+            return false;
+        stats.depthSamples++;
+        stats.depthSum += count;
+        item = pop();
+        window.takes++;
+        maybeAdapt();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Close the current window if it has run its course; for buffers too idle to do it themselves
+    void adapt() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (Clock::now() - windowStart >= policy.window)
+            resize();
+    }
+
+    // Wake everyone; puts fail from now on, takes drain what is left
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    void producerDone() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--producers <= 0) {
+            closed = true;
+            notFull.notify_all();
+            notEmpty.notify_all();
+        }
+    }
+
+    size_t capacity() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return limit;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count;
+    }
+
+    BufferStats statistics() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    ElasticStats elasticity() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ElasticStats result = elastic;
+        result.capacity = limit;
+        result.segments = segments.size() + (spare ? 1 : 0);
+        return result;
+    }
+
+private:
+    static const int OPS_PER_CLOCK_CHECK = 32;
+
+    // What happened since the window started
+    struct Window {
+        uint64_t puts = 0;
+        uint64_t takes = 0;
+        uint64_t fullWaits = 0;
+        uint64_t emptyWaits = 0;
+        size_t peakDepth = 0;
+    };
+
+    static ElasticPolicy normalized(ElasticPolicy policy) {
+        policy.minCapacity = std::max<size_t>(policy.minCapacity, 1);
+        policy.maxCapacity = std::max(policy.maxCapacity, policy.minCapacity);
+        policy.segmentItems = std::max<size_t>(policy.segmentItems, 1);
+        return policy;
+    }
+
+    template <typename Predicate>
+    void waitFor(std::unique_lock<std::mutex> &lock, std::condition_variable &cv, uint64_t &waitedNs,
+                 Predicate ready) {
+        auto start = Clock::now();
+        cv.wait(lock, ready);
+        waitedNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    void push(T item) {
+        size_t tail = head + count;
+        if (tail == segments.size() * policy.segmentItems) {
+            if (spare)
+                segments.emplace_back(std::move(spare));
+            else
+                segments.emplace_back(new T[policy.segmentItems]);
+        }
+        segments[tail / policy.segmentItems][tail % policy.segmentItems] = std::move(item);
+        count++;
+        stats.puts++;
+        if (count > stats.maxDepth)
+            stats.maxDepth = count;
+        if (count > window.peakDepth)
+            window.peakDepth = count;
+    }
+
+    T pop() {
+        T item = std::move(segments.front()[head]);
+        head++;
+        count--;
+        stats.takes++;
+
+        // Release the first segment once it has been read to the end, or rewind an emptied last one
+        if (head == policy.segmentItems) {
+            spare = std::move(segments.front());
+            segments.pop_front();
+            head = 0;
+        } else if (count == 0 && segments.size() == 1) {
+            head = 0;
+        }
+        return item;
+    }
+
+    // Checking the clock on every operation would cost more than the operation itself
+    void maybeAdapt() {
+        if (++opsSinceCheck < OPS_PER_CLOCK_CHECK && window.fullWaits == 0)
+            return;
+        opsSinceCheck = 0;
+        if (Clock::now() - windowStart >= policy.window)
+            resize();
+    }
+
+    void resize() {
+        double fullRate = window.puts > 0 ? static_cast<double>(window.fullWaits) / window.puts : 0.0;
+        double emptyRate = window.takes > 0 ? static_cast<double>(window.emptyWaits) / window.takes : 1.0;
+
+        if (window.fullWaits > 0 && fullRate >= policy.growAt && limit < policy.maxCapacity) {
+            limit = std::min(limit * 2, policy.maxCapacity);
+            elastic.grows++;
+            notFull.notify_all();
+        } else if (window.fullWaits == 0 && emptyRate >= policy.shrinkAt) {
+            // Never below twice what the window actually needed
+            size_t shrunk = std::max({limit / 2, 2 * window.peakDepth, policy.minCapacity});
+            if (shrunk < limit) {
+                limit = shrunk;
+                elastic.shrinks++;
+            }
+            spare.reset();
+            if (count == 0) {
+                segments.clear();  // an idle buffer holds no storage at all
+                head = 0;
+            }
+        }
+
+        window = Window();
+        window.peakDepth = count;
+        windowStart = Clock::now();
+    }
+
+    const ElasticPolicy policy;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<std::unique_ptr<T[]>> segments;
+    std::unique_ptr<T[]> spare;
+    size_t head = 0;  // in the first segment
+    size_t count = 0;
+    size_t limit;
+    int producers;
+    bool closed = false;
+    int opsSinceCheck = 0;
+    Window window;
+    Clock::time_point windowStart;
+    BufferStats stats;
+    ElasticStats elastic;
+};
+
+#endif
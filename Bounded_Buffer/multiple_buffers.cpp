@@ -4,30 +4,88 @@
 #include <condition_variable>
 #include <chrono>
 #include <cstdlib>
+#include "../Common/lock_profiler.h"
+#include "../Common/trace.h"
+#ifdef SPILL_CARTS
+#include "spilling_buffer.h"
+#endif
 
 
 const int CART_SIZE = 10; // Maximum number of balloon figures in the cart
 bool stopFlag = false;  // flag for program termination
 
+// Cart locks are profiled (contention report at exit) when built with -DLOCK_PROFILING. With
+// -DNUMA_CARTS they are NUMA-aware cohort locks, which keep hand-offs within a socket (up to a
+// fairness bound) so the carts' cache lines don't bounce between sockets on every acquisition
+#ifdef NUMA_CARTS
+#include "../Common/numa_lock.h"
+typedef ProfiledMutex<CohortLock> CartMutex;
+typedef std::condition_variable_any CartCondition;
+#else
+typedef ProfiledMutex<std::mutex> CartMutex;
+typedef ProfiledConditionVariable CartCondition;
+#endif
+
 int animalCart[CART_SIZE];  // Bounded buffer for animal balloons
 int producedAnimals = 0;  // keep track of produced animals
-std::mutex animalMtx;
-std::condition_variable cvAnimalCart;
+CartMutex animalMtx;
+CartCondition cvAnimalCart;
 
 int houseCart[CART_SIZE];  // Bounded buffer for house balloons
 int producedHouses = 0;  // keep track of produced houses
-std::mutex houseMtx;
-std::condition_variable cvHouseCart;
+CartMutex houseMtx;
+CartCondition cvHouseCart;
+
+#ifdef SPILL_CARTS
+// With -DSPILL_CARTS producers don't wait for a full cart: extra balloons are spilled to disk (in the
+// working directory) and moved into the cart as consumers empty it, oldest first
+SpillQueue<int> animalOverflow(".", "animal_cart");
+SpillQueue<int> houseOverflow(".", "house_cart");
+#endif
+
+
+#ifdef SPILL_CARTS
+// Spill a balloon if the cart is full or older balloons are already waiting on disk. Called with
+// the cart's mutex held; returns false if the producer has to wait for space after all
+bool spillBalloon(int produced, SpillQueue<int> &overflow, const char *cartName) {
+    if (produced < CART_SIZE && overflow.empty())
+        return false;
+    if (!overflow.push(1)) {
+        perror("spill");
+        return false;
+    }
+    std::cout << '\n' << cartName << " cart is full, balloon spilled (" << overflow.size() << " on disk)\n";
+    return true;
+}
+
+// Move spilled balloons into the cart's free slots. Called with the cart's mutex held
+void refillCart(int cart[], int &produced, SpillQueue<int> &overflow) {
+    int balloon;
+    for (int i = 0; i < CART_SIZE && produced < CART_SIZE; i++) {
+        if (cart[i] == 0 && overflow.pop(balloon)) {
+            cart[i] = balloon;
+            produced++;
+        }
+    }
+}
+#endif
 
 
 // Producer: Balloon Bob
 void produceAnimalBalloons() {
+    TRACE_THREAD_NAME("Balloon Bob");
     while (!stopFlag) {
         // Sleep a random amount of time (1 - 10 seconds)
         std::this_thread::sleep_for(std::chrono::seconds(rand() % 10 + 1));
 
+        TRACE_SCOPE("produce animal");
         // Mutex is automatically unlocked when unique_lock goes out of scope (at end of while iteration)
-        std::unique_lock<std::mutex> lock(animalMtx);
+        std::unique_lock<CartMutex> lock(animalMtx);
+
+#ifdef SPILL_CARTS
+        if (spillBalloon(producedAnimals, animalOverflow, "Animal"))
+            continue;
+#endif
 
         // Wait if the cart is full (automatically releases the mutex and blocks the thread)
         cvAnimalCart.wait(lock, [] { return producedAnimals < CART_SIZE; });
@@ -39,6 +97,7 @@ void produceAnimalBalloons() {
                 std::cout << "Full = " << producedAnimals << " ; Empty = " << CART_SIZE - producedAnimals << std::endl;
                 animalCart[i] = 1;
                 producedAnimals++;
+                TRACE_COUNTER("animal cart", producedAnimals);
 
                 std::cout << "Animal producer has produced...\n";
                 std::cout << "Updated Full = " << producedAnimals << " ; Updated Empty = " << CART_SIZE - producedAnimals << std::endl;
@@ -53,12 +112,19 @@ void produceAnimalBalloons() {
 
 // Producer: Hellium Harry
 void produceHouseBalloons() {
+    TRACE_THREAD_NAME("Helium Harry");
     while (!stopFlag) {
         // Sleep for a random time (1 - 10 seconds)
         std::this_thread::sleep_for(std::chrono::seconds(rand() % 10 + 1));
 
+        TRACE_SCOPE("produce house");
         // Mutex is automatically unlocked when unique_lock goes out of scope (at end of while iteration)
-        std::unique_lock<std::mutex> lock(houseMtx);
+        std::unique_lock<CartMutex> lock(houseMtx);
+
+#ifdef SPILL_CARTS
+        if (spillBalloon(producedHouses, houseOverflow, "House"))
+            continue;
+#endif
 
         // Wait if the cart is full (automatically releases the mutex and blocks the thread)
         cvHouseCart.wait(lock, [] { return producedHouses < CART_SIZE; });
@@ -70,6 +136,7 @@ void produceHouseBalloons() {
                 std::cout << "Full = " << producedHouses << " ; Empty = " << CART_SIZE - producedHouses << std::endl;
                 houseCart[i] = 1;
                 producedHouses++;
+                TRACE_COUNTER("house cart", producedHouses);
 
                 std::cout << "House producer has produced...\n";
                 std::cout << "Updated Full = " << producedHouses << " ; Updated Empty = " << CART_SIZE - producedHouses << std::endl;
@@ -84,9 +151,11 @@ void produceHouseBalloons() {
 
 // Consumer: customers wanting only animal balloons
 void consumeAnimalBalloons() {
+    TRACE_THREAD_NAME("animal consumer");
     while (!stopFlag) {
+        TRACE_BEGIN("consume animal");
         // Mutex is automatically unlocked when unique_lock goes out of scope (at end of while iteration)
-        std::unique_lock<std::mutex> lock(animalMtx);
+        std::unique_lock<CartMutex> lock(animalMtx);
 
         // Wait if the cart is empty
         cvAnimalCart.wait(lock, [] { return producedAnimals > 0; });
@@ -98,6 +167,7 @@ void consumeAnimalBalloons() {
                 std::cout << "Full = " << producedAnimals << " ; Empty = " << CART_SIZE - producedAnimals << std::endl;
                 animalCart[i] = 0;
                 producedAnimals--;
+                TRACE_COUNTER("animal cart", producedAnimals);
 
                 std::cout << "Animal consumer has consumed...\n";
                 std::cout << "Updated Full = " << producedAnimals << " ; Updated Empty = " << CART_SIZE - producedAnimals << std::endl;
@@ -105,10 +175,14 @@ void consumeAnimalBalloons() {
             }
         }
 
+#ifdef SPILL_CARTS
+        refillCart(animalCart, producedAnimals, animalOverflow);
+#endif
         cvAnimalCart.notify_all(); // Notify animal producer that space is available
 
         // Free mutex before sleeping
         lock.unlock();
+        TRACE_END("consume animal");
 
         // Sleep for a random amount of time (1- 15 seconds)
         std::this_thread::sleep_for(std::chrono::seconds(rand() % 11 + 5));
@@ -118,9 +192,11 @@ void consumeAnimalBalloons() {
 
 // Consumer: customers wanting only house balloons
 void consumeHouseBalloons() {
+    TRACE_THREAD_NAME("house consumer");
     while (!stopFlag) {
+        TRACE_BEGIN("consume house");
         // Mutex is automatically unlocked when unique_lock goes out of scope (at end of while iteration)
-        std::unique_lock<std::mutex> lock(houseMtx);
+        std::unique_lock<CartMutex> lock(houseMtx);
 
         // Wait if the cart is empty
         cvHouseCart.wait(lock, [] { return producedHouses > 0; });
@@ -132,6 +208,7 @@ void consumeHouseBalloons() {
                 std::cout << "Full = " << producedHouses << " ; Empty = " << CART_SIZE - producedHouses << std::endl;
                 houseCart[i] = 0;
                 producedHouses--;
+                TRACE_COUNTER("house cart", producedHouses);
 
                 std::cout << "House consumer has consumed...\n";
                 std::cout << "Updated Full = " << producedHouses << " ; Updated Empty = " << CART_SIZE - producedHouses << std::endl;
@@ -139,10 +216,14 @@ void consumeHouseBalloons() {
             }
         }
 
+#ifdef SPILL_CARTS
+        refillCart(houseCart, producedHouses, houseOverflow);
+#endif
         cvHouseCart.notify_all(); // Notify house producer that space is available
 
         // Free mutex before sleeping
         lock.unlock();
+        TRACE_END("consume house");
 
         // Sleep a random amount of time (1- 15 seconds)
         std::this_thread::sleep_for(std::chrono::seconds(rand() % 11 + 5));
@@ -152,10 +233,12 @@ void consumeHouseBalloons() {
 
 // Consumer: cusotmers wanting both balloon types
 void consumeBothBalloons() {
+    TRACE_THREAD_NAME("animal & house consumer");
     while (!stopFlag) {
+        TRACE_BEGIN("consume both");
         // Mutexes are automatically unlocked when they go out of scope (at end of while iteration)
-        std::unique_lock<std::mutex> animalLock(animalMtx);
-        std::unique_lock<std::mutex> houseLock(houseMtx);
+        std::unique_lock<CartMutex> animalLock(animalMtx);
+        std::unique_lock<CartMutex> houseLock(houseMtx);
 
         // Wait if either cart is empty
         cvAnimalCart.wait(animalLock, [] { return producedAnimals > 0; });
@@ -170,6 +253,7 @@ void consumeBothBalloons() {
                 std::cout << "Animals: Full = " << producedAnimals << " ; Empty = " << CART_SIZE - producedAnimals << std::endl;
                 animalCart[i] = 0;
                 producedAnimals--;
+                TRACE_COUNTER("animal cart", producedAnimals);
 
                 std::cout << "Animal & House consumer consumed an animal...\n";
                 std::cout << "Animals: Updated Full = " << producedAnimals << " ; Updated Empty = " << CART_SIZE - producedAnimals << std::endl;
@@ -179,6 +263,7 @@ void consumeBothBalloons() {
                 std::cout << "Houses: Full = " << producedHouses << " ; Empty = " << CART_SIZE - producedHouses << std::endl;
                 houseCart[i] = 0;
                 producedHouses--;
+                TRACE_COUNTER("house cart", producedHouses);
 
                 std::cout << "Animal & House consumer consumed a house...\n";
                 std::cout << "Houses: Updated Full = " << producedHouses << " ; Updated Empty = " << CART_SIZE - producedHouses << std::endl;
@@ -187,6 +272,11 @@ void consumeBothBalloons() {
             if (animalsDone && housesDone) break;
         }
 
+#ifdef SPILL_CARTS
+        refillCart(animalCart, producedAnimals, animalOverflow);
+        refillCart(houseCart, producedHouses, houseOverflow);
+#endif
+
         // Notify producers that space is available
         cvAnimalCart.notify_all();
         cvHouseCart.notify_all();
@@ -194,6 +284,7 @@ void consumeBothBalloons() {
         // Free both mutexes before sleeping
         animalLock.unlock();
         houseLock.unlock();
+        TRACE_END("consume both");
 
         // Sleep a random amount of time (5 - 15 seconds)
         std::this_thread::sleep_for(std::chrono::seconds(rand() % 11 + 5));
@@ -205,29 +296,40 @@ void outputBufferInfo() {
     while (!stopFlag) {
         std::this_thread::sleep_for(std::chrono::seconds(10));  // output with ~10 seconds in between
 
-        // Print Animal buffer first to unlock animalMtx
-        std::unique_lock<std::mutex> animalLock(animalMtx);
+        // Print Animal buffer first to unlock animalMtx. try_to_lock tells whether the mutex was free
+        std::unique_lock<CartMutex> animalLock(animalMtx, std::try_to_lock);
+        bool animalMtxWasFree = animalLock.owns_lock();
+        if (!animalMtxWasFree)
+            animalLock.lock();
 
         std::cout << "\nAnimal buffer: ";
         for (int i = 0; i < CART_SIZE; i++)
             std::cout << '[' << i << "] -> " << animalCart[i] << " ;;; ";
-        std::cout << "FULL SLOTS = " << producedAnimals << " AND EMPTY SLOTS = " << CART_SIZE - producedAnimals << " ;;; MUTEX IS AVAILABLE\n";
+        std::cout << "FULL SLOTS = " << producedAnimals << " AND EMPTY SLOTS = " << CART_SIZE - producedAnimals
+                  << " ;;; MUTEX WAS " << (animalMtxWasFree ? "AVAILABLE\n" : "IN USE\n");
 
-        animalMtx.unlock();
+        animalLock.unlock();
 
         // Print House buffer
-        std::unique_lock<std::mutex> houseLock(houseMtx);
+        std::unique_lock<CartMutex> houseLock(houseMtx, std::try_to_lock);
+        bool houseMtxWasFree = houseLock.owns_lock();
+        if (!houseMtxWasFree)
+            houseLock.lock();
 
         std::cout << "\nHouse buffer: ";
         for (int i = 0; i < CART_SIZE; i++)
             std::cout << '[' << i << "] -> " << houseCart[i] << " ;;; ";
-        std::cout << "FULL SLOTS = " << producedHouses << " AND EMPTY SLOTS = " << CART_SIZE - producedHouses << " ;;; MUTEX IS AVAILABLE\n";
+        std::cout << "FULL SLOTS = " << producedHouses << " AND EMPTY SLOTS = " << CART_SIZE - producedHouses
+                  << " ;;; MUTEX WAS " << (houseMtxWasFree ? "AVAILABLE\n" : "IN USE\n");
     }
 }
 
 
 int main() {
     srand(time(nullptr));  // generate a random seed to be used by rand()
+    nameLock(animalMtx, "animal cart");
+    nameLock(houseMtx, "house cart");
+    TRACE_START("multiple_buffers.trace.json");  // timeline of the run with -DEVENT_TRACING
 
     // Create producer and consumer threads
     std::thread balloonBob(produceAnimalBalloons);
@@ -250,6 +352,7 @@ int main() {
     houseConsumer.join();
     bothConsumer.join();
     bufferInfo.join();
+    TRACE_STOP();
 
     std::cout << "\n45 seconds have passed, exiting program\n\n";
 }
@@ -0,0 +1,216 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <sched.h>
+#include "bounded_buffer.h"
+#include "../Common/histogram.h"
+#include "../Common/numa.h"
+#include "../Common/numa_lock.h"
+#include "../Common/perf_counters.h"
+
+
+// std::mutex against the NUMA-aware CohortLock, with threads spread round-robin over the NUMA
+// nodes (thread i on node i % nodes):
+//
+//  - lock rows: every thread repeatedly takes the lock and updates --lines shared cache lines, like
+//    a cart's slots and counters. node_switch_pct is the share of acquisitions whose previous
+//    holder ran on another node, i.e. how often the protected lines crossed the interconnect
+//  - buffer rows: every thread but one puts into a BoundedBuffer and the last thread consumes,
+//    with the ring in default (first touch by the creating thread) memory for std::mutex and
+//    on the consumer's node for the cohort lock
+//
+//   numa_lock_benchmark [--threads N] [--seconds S] [--lines L] [--bounds b1,b2,..]
+//
+// Every row ends with hardware counters for the run and per operation (acquisition or item).
+// On a single node machine the cohort lock degenerates to two nested ticket locks, so its rows
+// show its overhead rather than any benefit
+
+typedef std::chrono::steady_clock Clock;
+
+struct Config {
+    int threads = 0;  // 0 == one per CPU, at least 2
+    int seconds = 2;
+    int lines = 4;
+    std::vector<int> bounds = {1, 16, COHORT_MAX_HANDOFFS, 1024};
+};
+
+std::atomic<bool> stopFlag(false);
+
+
+int nodeForThread(int thread) {
+    return thread % NumaTopology::instance().nodes();
+}
+
+void pinThread(int thread) {
+    const NumaTopology &topology = NumaTopology::instance();
+    const std::vector<int> &cpus = topology.cpusOf(nodeForThread(thread));
+    int cpu = cpus[(thread / topology.nodes()) % cpus.size()];
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+
+// Data the lock protects, one cache line per entry
+struct alignas(64) SharedLine {
+    uint64_t value = 0;
+};
+
+template <typename Lock>
+void runLock(const std::string &name, Lock &lock, const Config &config) {
+    std::vector<SharedLine> shared(config.lines);
+    int lastNode = -1;
+    uint64_t nodeSwitches = 0;
+
+    std::vector<uint64_t> acquisitions(config.threads, 0);
+    std::vector<LatencyHistogram> waits(config.threads);
+    std::vector<std::thread> threads;
+    PerfCounters counters;
+
+    stopFlag = false;
+    counters.start();
+    auto start = Clock::now();
+    for (int t = 0; t < config.threads; t++) {
+        threads.emplace_back([&, t] {
+            pinThread(t);
+            int node = nodeForThread(t);
+            uint64_t count = 0;
+            LatencyHistogram wait;
+            while (!stopFlag.load(std::memory_order_relaxed)) {
+                auto before = Clock::now();
+                lock.lock();
+                wait.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count());
+                if (node != lastNode) {
+                    nodeSwitches++;
+                    lastNode = node;
+                }
+                for (SharedLine &line : shared)
+                    line.value++;
+                lock.unlock();
+                count++;
+            }
+            acquisitions[t] = count;
+            waits[t] = wait;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(config.seconds));
+    stopFlag = true;
+    for (std::thread &thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    PerfSample perf = counters.stop();
+
+    uint64_t total = 0;
+    LatencyHistogram wait;
+    for (int t = 0; t < config.threads; t++) {
+        total += acquisitions[t];
+        wait.merge(waits[t]);
+    }
+    auto minmax = std::minmax_element(acquisitions.begin(), acquisitions.end());
+    double mean = static_cast<double>(total) / config.threads;
+
+    std::cout << "lock," << name << ',' << config.threads << ',' << NumaTopology::instance().nodes() << ','
+              << static_cast<uint64_t>(total / seconds) << ',' << (total > 0 ? 100.0 * nodeSwitches / total : 0.0)
+              << ',' << (mean > 0 ? (*minmax.second - *minmax.first) / mean : 0.0) << ','
+              << wait.percentile(0.99) << ',' << wait.max() << perf.csv(total) << std::endl;
+}
+
+
+// Producers on every node, one consumer on the last thread's node
+template <typename Buffer>
+void runBuffer(const std::string &name, Buffer &buffer, const Config &config) {
+    int producers = config.threads - 1;
+    std::vector<std::thread> threads;
+    uint64_t consumed = 0;
+    PerfCounters counters;
+
+    stopFlag = false;
+    counters.start();
+    auto start = Clock::now();
+    for (int t = 0; t < producers; t++) {
+        threads.emplace_back([&, t] {
+            pinThread(t);
+            for (uint64_t i = 0; !stopFlag.load(std::memory_order_relaxed); i++)
+                if (!buffer.put(i))
+                    break;
+            buffer.producerDone();
+        });
+    }
+    std::thread consumer([&] {
+        pinThread(config.threads - 1);
+        uint64_t item;
+        while (buffer.take(item))
+            consumed++;
+    });
+
+    std::this_thread::sleep_for(std::chrono::seconds(config.seconds));
+    stopFlag = true;
+    for (std::thread &thread : threads)
+        thread.join();
+    consumer.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    PerfSample perf = counters.stop();
+
+    std::cout << "buffer," << name << ',' << config.threads << ',' << NumaTopology::instance().nodes() << ','
+              << static_cast<uint64_t>(consumed / seconds) << ",,,," << perf.csv(consumed) << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+    Config config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--threads") config.threads = atoi(argv[i + 1]);
+        else if (option == "--seconds") config.seconds = atoi(argv[i + 1]);
+        else if (option == "--lines") config.lines = atoi(argv[i + 1]);
+        else if (option == "--bounds") {
+            config.bounds.clear();
+            for (const char *p = argv[i + 1]; *p != '\0'; ) {
+                config.bounds.emplace_back(atoi(p));
+                while (*p != '\0' && *p++ != ',')
+                    ;
+            }
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--threads N] [--seconds S] [--lines L] [--bounds b1,b2,..]\n";
+            return 1;
+        }
+    }
+    if (config.threads == 0)
+        config.threads = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+    if (config.threads < 2 || config.seconds < 1 || config.lines < 0) {
+        std::cerr << "Need at least 2 threads and 1 second\n";
+        return 1;
+    }
+
+    const NumaTopology &topology = NumaTopology::instance();
+    if (topology.nodes() < 2)
+        std::cerr << "Note: single NUMA node, no cross-node traffic to save\n";
+
+    // spread == (max - min) / mean acquisitions per thread; lower is fairer
+    std::cout << "test,lock,threads,nodes,ops_per_s,node_switch_pct,spread,p99_wait_ns,max_wait_ns" << perfCsvHeader()
+              << '\n';
+    std::mutex mutex;
+    runLock("std_mutex", mutex, config);
+    for (int bound : config.bounds) {
+        CohortLock cohort(bound);
+        runLock("cohort_" + std::to_string(bound), cohort, config);
+    }
+
+    BoundedBuffer<uint64_t> plainBuffer(1024, config.threads - 1);
+    runBuffer("std_mutex", plainBuffer, config);
+
+    int consumerNode = nodeForThread(config.threads - 1);
+    BoundedBuffer<uint64_t, CohortLock, NodeAllocator<uint64_t>> numaBuffer(1024, config.threads - 1,
+                                                                             NodeAllocator<uint64_t>(consumerNode));
+    runBuffer("cohort_" + std::to_string(COHORT_MAX_HANDOFFS) + "_consumer_node", numaBuffer, config);
+}
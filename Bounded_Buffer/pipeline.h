@@ -0,0 +1,239 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sched.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "bounded_buffer.h"
+
+
+// Multi-stage producer/consumer pipelines built from BoundedBuffers. Every stage runs its own
+// worker threads and hands its output to the next stage through a buffer, so a slow stage backs
+// up the ones before it instead of piling up work:
+//
+//   Pipeline pipeline;
+//   auto lines = pipeline.source<std::string>("read", {1}, readLine);
+//   auto records = pipeline.stage("parse", {4, 64}, lines, parseLine);
+//   pipeline.sink("store", {1, 64}, records, storeRecord);
+//   pipeline.run();
+//   pipeline.report(std::cout);
+//
+// A source function fills in its argument and returns false when it has nothing more; with several
+// workers it is called concurrently, as are stage and sink functions. When every worker of a stage
+// has finished, its output buffer closes and the next stage drains it and finishes in turn. Every
+// stream must be consumed by exactly one stage or sink
+
+struct StageOptions {
+    int parallelism = 1;  // worker threads
+    size_t batch = 1;  // items moved per buffer operation, in and out
+    size_t queueCapacity = 1024;  // of the buffer this stage writes to
+    std::vector<int> cpus;  // worker i is pinned to cpus[i % cpus.size()]; empty == not pinned
+
+    StageOptions(int parallelism = 1, size_t batch = 1, size_t queueCapacity = 1024, std::vector<int> cpus = {})
+        : parallelism(parallelism > 0 ? parallelism : 1), batch(batch > 0 ? batch : 1),
+          queueCapacity(queueCapacity), cpus(std::move(cpus)) {}
+};
+
+
+template <typename T>
+class Stream {
+    friend class Pipeline;
+    std::shared_ptr<BoundedBuffer<T>> buffer;
+};
+
+
+class Pipeline {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    template <typename Out, typename Produce>
+    Stream<Out> source(const std::string &name, const StageOptions &options, Produce produce) {
+        Stream<Out> output = makeStream<Out>(options);
+        std::shared_ptr<BoundedBuffer<Out>> out = output.buffer;
+        Stage &stage = addStage(name, options);
+        stage.output = [out] { return out->statistics(); };
+
+        stage.body = [out, produce, &stage](int worker) mutable {
+            std::vector<Out> batch;
+            Out item;
+            bool more = true;
+            while (more) {
+                auto start = Clock::now();
+                while (batch.size() < stage.options.batch && (more = produce(item)))
+                    batch.emplace_back(std::move(item));
+                stage.workers[worker].busyNs += elapsedNs(start);
+                stage.workers[worker].items += batch.size();
+                if (!out->putBatch(batch))
+                    break;
+            }
+            out->producerDone();
+        };
+        return output;
+    }
+
+    template <typename In, typename Transform, typename Out = decltype(std::declval<Transform&>()(std::declval<In&>()))>
+    Stream<Out> stage(const std::string &name, const StageOptions &options, Stream<In> input, Transform transform) {
+        Stream<Out> output = makeStream<Out>(options);
+        std::shared_ptr<BoundedBuffer<In>> in = input.buffer;
+        std::shared_ptr<BoundedBuffer<Out>> out = output.buffer;
+        Stage &stage = addStage(name, options);
+        stage.input = [in] { return std::make_pair(in->statistics(), in->capacity()); };
+        stage.output = [out] { return out->statistics(); };
+
+        stage.body = [in, out, transform, &stage](int worker) mutable {
+            std::vector<In> items;
+            std::vector<Out> results;
+            while (in->takeBatch(items, stage.options.batch)) {
+                auto start = Clock::now();
+                for (In &item : items)
+                    results.emplace_back(transform(item));
+                stage.workers[worker].busyNs += elapsedNs(start);
+                stage.workers[worker].items += items.size();
+                if (!out->putBatch(results))
+                    break;
+            }
+            out->producerDone();
+        };
+        return output;
+    }
+
+    template <typename In, typename Consume>
+    void sink(const std::string &name, const StageOptions &options, Stream<In> input, Consume consume) {
+        std::shared_ptr<BoundedBuffer<In>> in = input.buffer;
+        Stage &stage = addStage(name, options);
+        stage.input = [in] { return std::make_pair(in->statistics(), in->capacity()); };
+
+        stage.body = [in, consume, &stage](int worker) mutable {
+            std::vector<In> items;
+            while (in->takeBatch(items, stage.options.batch)) {
+                auto start = Clock::now();
+                for (In &item : items)
+                    consume(item);
+                stage.workers[worker].busyNs += elapsedNs(start);
+                stage.workers[worker].items += items.size();
+            }
+        };
+    }
+
+    // Start every worker and wait until the last stage has drained its input
+    void run() {
+        std::vector<std::thread> threads;
+        auto start = Clock::now();
+        for (std::unique_ptr<Stage> &stage : stages) {
+            for (int w = 0; w < stage->options.parallelism; w++) {
+                Stage *s = stage.get();
+                threads.emplace_back([s, w] {
+                    if (!s->options.cpus.empty())
+                        pinToCpu(s->options.cpus[w % s->options.cpus.size()]);
+                    s->body(w);
+                });
+            }
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+        wallNs = elapsedNs(start);
+    }
+
+    // One line per stage. busy: share of the stage's worker time spent in its function. starved:
+    // share spent waiting for input; the stage before it is too slow. blocked: share spent waiting
+    // for room in the output buffer; a stage after it is too slow. depth: mean items found in the
+    // input buffer. The bottleneck is the busiest stage; its input runs full, the stages before it
+    // are blocked and everything after it starves
+    void report(std::ostream &out) {
+        out << "stage,workers,items,busy_pct,starved_pct,blocked_pct,input_depth,input_max_depth,input_capacity\n";
+        size_t bottleneck = 0;
+        double bottleneckBusy = -1;
+
+        for (size_t i = 0; i < stages.size(); i++) {
+            Stage &stage = *stages[i];
+            uint64_t busyNs = 0, items = 0;
+            for (const WorkerStats &worker : stage.workers) {
+                busyNs += worker.busyNs;
+                items += worker.items;
+            }
+            double workerNs = static_cast<double>(wallNs) * stage.options.parallelism;
+            double busy = workerNs > 0 ? 100.0 * busyNs / workerNs : 0.0;
+
+            out << stage.name << ',' << stage.options.parallelism << ',' << items << ',' << std::fixed
+                << std::setprecision(1) << busy << ',';
+            std::pair<BufferStats, size_t> input;
+            if (stage.input) {
+                input = stage.input();
+                out << (workerNs > 0 ? 100.0 * input.first.emptyWaitNs / workerNs : 0.0);
+            }
+            out << ',';
+            if (stage.output)
+                out << (workerNs > 0 ? 100.0 * stage.output().fullWaitNs / workerNs : 0.0);
+            out << ',';
+            if (stage.input)
+                out << input.first.meanDepth() << ',' << input.first.maxDepth << ',' << input.second << '\n';
+            else
+                out << ",,\n";
+            out.unsetf(std::ios::floatfield);
+
+            if (busy > bottleneckBusy) {
+                bottleneckBusy = busy;
+                bottleneck = i;
+            }
+        }
+        if (!stages.empty())
+            out << "bottleneck: " << stages[bottleneck]->name << ", " << wallNs / 1000000 << " ms total\n";
+    }
+
+    uint64_t elapsedWallNs() const { return wallNs; }
+
+private:
+    struct alignas(64) WorkerStats {  // one cache line each, workers update them after every batch
+        uint64_t busyNs = 0;
+        uint64_t items = 0;
+    };
+
+    struct Stage {
+        std::string name;
+        StageOptions options;
+        std::vector<WorkerStats> workers;
+        std::function<void(int)> body;
+        std::function<std::pair<BufferStats, size_t>()> input;  // statistics and capacity, sources have none
+        std::function<BufferStats()> output;  // sinks have none
+    };
+
+    template <typename T>
+    static Stream<T> makeStream(const StageOptions &options) {
+        Stream<T> stream;
+        stream.buffer = std::make_shared<BoundedBuffer<T>>(options.queueCapacity, options.parallelism);
+        return stream;
+    }
+
+    Stage &addStage(const std::string &name, const StageOptions &options) {
+        stages.emplace_back(new Stage());
+        Stage &stage = *stages.back();
+        stage.name = name;
+        stage.options = options;
+        stage.workers.resize(options.parallelism);
+        return stage;
+    }
+
+    static uint64_t elapsedNs(Clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    static void pinToCpu(int cpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+
+    std::vector<std::unique_ptr<Stage>> stages;
+    uint64_t wallNs = 0;
+};
+
+#endif
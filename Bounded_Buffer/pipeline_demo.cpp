@@ -0,0 +1,96 @@
+#include "pipeline.h"
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <cstdlib>
+
+
+// A six-stage pipeline with one deliberately expensive stage ("simulate"), to show how the report
+// points at the bottleneck and what parallelism and batching change:
+//
+//   pipeline_demo [--items N] [--batch B] [--capacity C] [--simulate-workers W] [--pin]
+//
+// With --pin, stage workers are pinned to consecutive CPUs in stage order
+
+struct Order {
+    uint64_t id = 0;
+    uint64_t payload = 0;
+    uint64_t checksum = 0;
+};
+
+
+// Busy work standing in for real per-item processing: rounds of xorshift
+uint64_t mix(uint64_t x, int rounds) {
+    for (int i = 0; i < rounds; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    return x;
+}
+
+
+int main(int argc, char *argv[]) {
+    long items = 1000000;
+    size_t batch = 64;
+    size_t capacity = 1024;
+    int simulateWorkers = 1;
+    bool pin = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--pin") pin = true;
+        else if (option == "--items" && i + 1 < argc) items = atol(argv[++i]);
+        else if (option == "--batch" && i + 1 < argc) batch = atol(argv[++i]);
+        else if (option == "--capacity" && i + 1 < argc) capacity = atol(argv[++i]);
+        else if (option == "--simulate-workers" && i + 1 < argc) simulateWorkers = atoi(argv[++i]);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--items N] [--batch B] [--capacity C] [--simulate-workers W] [--pin]\n";
+            return 1;
+        }
+    }
+
+    int nextCpu = 0;
+    int cpus = std::thread::hardware_concurrency();
+    auto options = [&](int workers) {
+        std::vector<int> pinned;
+        for (int w = 0; pin && w < workers; w++)
+            pinned.emplace_back(nextCpu++ % cpus);
+        return StageOptions(workers, batch, capacity, pinned);
+    };
+
+    Pipeline pipeline;
+    std::atomic<long> nextId(0);
+    auto orders = pipeline.source<Order>("generate", options(1), [&](Order &order) {
+        long id = nextId.fetch_add(1, std::memory_order_relaxed);
+        if (id >= items)
+            return false;
+        order.id = id;
+        order.payload = mix(id + 1, 4);
+        return true;
+    });
+    auto checked = pipeline.stage("checksum", options(1), orders, [](Order &order) {
+        order.checksum = mix(order.payload, 16);
+        return order;
+    });
+    auto simulated = pipeline.stage("simulate", options(simulateWorkers), checked, [](Order &order) {
+        order.payload = mix(order.payload ^ order.checksum, 400);
+        return order;
+    });
+    auto priced = pipeline.stage("price", options(1), simulated, [](Order &order) {
+        return std::make_pair(order.id, order.payload % 10000);
+    });
+    auto taxed = pipeline.stage("tax", options(1), priced, [](std::pair<uint64_t, uint64_t> &price) {
+        return price.second + price.second / 5;
+    });
+
+    uint64_t total = 0, count = 0;
+    pipeline.sink("total", options(1), taxed, [&](uint64_t &amount) {
+        total += amount;
+        count++;
+    });
+
+    pipeline.run();
+    pipeline.report(std::cout);
+    std::cout << count << " orders, total " << total << '\n';
+}
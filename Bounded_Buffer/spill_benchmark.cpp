@@ -0,0 +1,93 @@
+#include "spilling_buffer.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include "../Common/histogram.h"
+
+
+// Producer latency of a bounded buffer whose consumer stalls now and then, with and without
+// spilling to disk. The producer puts one item every --interval-us; the consumer takes items as
+// they come but every --stall-every items sleeps --stall-ms. The consumer also checks that items
+// arrive in order. One CSV row per mode:
+//
+//   spill_benchmark [--capacity N] [--items N] [--interval-us U] [--stall-every N] [--stall-ms M]
+//                   [--dir PATH] [--mode blocking|spilling|all]
+
+typedef std::chrono::steady_clock Clock;
+
+struct Config {
+    int capacity = 1024;
+    long items = 2000000;
+    int intervalUs = 1;
+    long stallEvery = 200000;
+    int stallMs = 200;
+    std::string directory = "/tmp";
+};
+
+
+void runMode(const std::string &mode, const Config &config) {
+    SpillingBuffer<uint64_t> buffer(config.capacity, mode == "spilling" ? config.directory : "", "spill_benchmark");
+    LatencyHistogram putLatency;
+    bool ordered = true;
+
+    auto start = Clock::now();
+    std::thread consumer([&] {
+        for (long i = 0; i < config.items; i++) {
+            if (buffer.take() != static_cast<uint64_t>(i))
+                ordered = false;
+            if ((i + 1) % config.stallEvery == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(config.stallMs));
+        }
+    });
+
+    auto next = Clock::now();
+    for (long i = 0; i < config.items; i++) {
+        while (Clock::now() < next)
+            ;
+        auto before = Clock::now();
+        buffer.put(i);
+        putLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count());
+        next += std::chrono::microseconds(config.intervalUs);
+    }
+    uint64_t spilled = buffer.totalSpilled();
+    consumer.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << mode << ',' << config.capacity << ',' << config.items << ',' << config.items / config.stallEvery << ','
+              << putLatency.percentile(0.50) << ',' << putLatency.percentile(0.99) << ','
+              << putLatency.percentile(0.9999) << ',' << putLatency.max() << ',' << spilled << ','
+              << (ordered ? "yes" : "no") << ',' << seconds << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+    Config config;
+    std::string mode = "all";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--capacity") config.capacity = atoi(argv[i + 1]);
+        else if (option == "--items") config.items = atol(argv[i + 1]);
+        else if (option == "--interval-us") config.intervalUs = atoi(argv[i + 1]);
+        else if (option == "--stall-every") config.stallEvery = atol(argv[i + 1]);
+        else if (option == "--stall-ms") config.stallMs = atoi(argv[i + 1]);
+        else if (option == "--dir") config.directory = argv[i + 1];
+        else if (option == "--mode") mode = argv[i + 1];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--capacity N] [--items N] [--interval-us U] [--stall-every N]"
+                      << " [--stall-ms M] [--dir PATH] [--mode blocking|spilling|all]\n";
+            return 1;
+        }
+    }
+    if (config.capacity < 1 || config.items < 1 || config.stallEvery < 1) {
+        std::cerr << "Need capacity, items and stall-every >= 1\n";
+        return 1;
+    }
+
+    std::cout << "mode,capacity,items,stalls,p50_put_ns,p99_put_ns,p9999_put_ns,max_put_ns,spilled,in_order,seconds\n";
+    if (mode == "blocking" || mode == "all")
+        runMode("blocking", config);
+    if (mode == "spilling" || mode == "all")
+        runMode("spilling", config);
+}
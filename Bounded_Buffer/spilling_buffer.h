@@ -0,0 +1,200 @@
+#ifndef SPILLING_BUFFER_H
+#define SPILLING_BUFFER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+const size_t SPILL_SEGMENT_SIZE = 16 * 1024 * 1024;
+
+
+// FIFO of fixed-size records on disk, for when a bounded buffer overflows. Records are appended to
+// a chain of segment files of segmentSize bytes, each mapped while it is written or read, so at
+// most the segment being written and the one being read are mapped however much has spilled.
+// Writes and reads both go front to back through each file, which the page cache turns into
+// sequential I/O. A segment file is unlinked as soon as it is mapped, so it is reclaimed when it
+// is unmapped (or the process dies) and nothing is left behind in the spill directory.
+//
+// Not thread-safe: the owning buffer calls it under its own lock
+template <typename T>
+class SpillQueue {
+    static_assert(std::is_trivially_copyable<T>::value, "spilled records are copied as raw bytes");
+
+public:
+    SpillQueue(const std::string &directory, const std::string &name, size_t segmentSize = SPILL_SEGMENT_SIZE)
+        : directory(directory), name(name),
+          recordsPerSegment(segmentSize / sizeof(T) > 0 ? segmentSize / sizeof(T) : 1) {}
+
+    ~SpillQueue() {
+        for (Segment &segment : segments)
+            munmap(segment.records, recordsPerSegment * sizeof(T));
+    }
+
+    SpillQueue(const SpillQueue&) = delete;
+    SpillQueue &operator=(const SpillQueue&) = delete;
+
+    // Append a record. Returns false (and leaves errno set) if a new segment couldn't be created
+    bool push(const T &record) {
+        if (segments.empty() || segments.back().written == recordsPerSegment) {
+            if (!addSegment())
+                return false;
+        }
+        Segment &segment = segments.back();
+        memcpy(&segment.records[segment.written++], &record, sizeof(T));
+        count++;
+        return true;
+    }
+
+    // Remove the oldest record. Returns false if the queue is empty
+    bool pop(T &record) {
+        if (count == 0)
+            return false;
+        Segment &segment = segments.front();
+        memcpy(&record, &segment.records[segment.read++], sizeof(T));
+        count--;
+
+        // Drop a segment once it is read to the end; only the last one can be read up to its write position
+        if (segment.read == recordsPerSegment) {
+            munmap(segment.records, recordsPerSegment * sizeof(T));
+            segments.pop_front();
+        } else if (count == 0) {
+            segment.read = segment.written = 0;  // empty again: rewrite the segment from the start
+        }
+        return true;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint64_t segmentsCreated() const { return created; }
+
+private:
+    struct Segment {
+        T *records;
+        size_t written;
+        size_t read;
+    };
+
+    bool addSegment() {
+        std::string path = directory + "/" + name + "." + std::to_string(getpid()) + "." + std::to_string(created) +
+                           ".spill";
+        size_t bytes = recordsPerSegment * sizeof(T);
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd == -1)
+            return false;
+        unlink(path.c_str());
+
+        void *p = MAP_FAILED;
+        if (ftruncate(fd, bytes) == 0)
+            p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED)
+            return false;
+
+        madvise(p, bytes, MADV_SEQUENTIAL);
+        segments.push_back(Segment{static_cast<T*>(p), 0, 0});
+        created++;
+        return true;
+    }
+
+    std::string directory;
+    std::string name;
+    size_t recordsPerSegment;
+    std::deque<Segment> segments;  // oldest first; only the last is written
+    size_t count = 0;
+    uint64_t created = 0;
+};
+
+
+// Bounded buffer that overflows to disk instead of blocking its producers. Items go into an
+// in-memory ring of the given capacity; once it is full they are appended to a SpillQueue, and as
+// consumers drain the ring it is refilled from the spill queue. While anything is spilled new items
+// are spilled behind it, so consumers see items in exactly the order they were put.
+//
+// With an empty spill directory the buffer never spills and put() blocks while the ring is full,
+// like the carts in multiple_buffers.cpp. If a spill segment can't be created put() also falls back
+// to blocking, so a full disk slows producers down instead of losing items
+template <typename T>
+class SpillingBuffer {
+public:
+    SpillingBuffer(size_t capacity, const std::string &spillDirectory = "", const std::string &name = "buffer",
+                   size_t segmentSize = SPILL_SEGMENT_SIZE)
+        : ring(capacity > 0 ? capacity : 1) {
+        if (!spillDirectory.empty())
+            spill.reset(new SpillQueue<T>(spillDirectory, name, segmentSize));
+    }
+
+    void put(const T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (spill && (count == ring.size() || !spill->empty())) {
+            if (spill->push(item)) {
+                spilledTotal++;
+                return;
+            }
+            perror("spill");
+        }
+
+        notFull.wait(lock, [this] { return count < ring.size() && (!spill || spill->empty()); });
+        ring[(head + count) % ring.size()] = item;
+        count++;
+        notEmpty.notify_one();
+    }
+
+    T take() {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return count > 0; });
+        T item = ring[head];
+        head = (head + 1) % ring.size();
+        count--;
+
+        // Move the oldest spilled items into the space just freed
+        T spilled;
+        while (spill && count < ring.size() && spill->pop(spilled)) {
+            ring[(head + count) % ring.size()] = spilled;
+            count++;
+        }
+
+        notFull.notify_one();
+        return item;
+    }
+
+    size_t capacity() const { return ring.size(); }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count + (spill ? spill->size() : 0);
+    }
+
+    size_t spilled() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return spill ? spill->size() : 0;
+    }
+
+    uint64_t totalSpilled() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return spilledTotal;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::vector<T> ring;
+    size_t head = 0;
+    size_t count = 0;
+    std::unique_ptr<SpillQueue<T>> spill;
+    uint64_t spilledTotal = 0;
+};
+
+#endif
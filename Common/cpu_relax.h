@@ -0,0 +1,14 @@
+#ifndef CPU_RELAX_H
+#define CPU_RELAX_H
+
+
+// Spin-wait hint: lets the sibling hyperthread run and saves power while polling a shared word
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+#endif
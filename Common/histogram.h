@@ -0,0 +1,101 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cstdint>
+#include <cstring>
+
+
+// Log-linear histogram in the style of HdrHistogram: every power of two is split into
+// SUB_BUCKETS linear buckets, so any recorded value is reported within 1/SUB_BUCKETS of itself
+// while the whole 64-bit range fits in a fixed array. Recording is a few instructions and
+// never allocates, so it can be used on hot paths
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        memset(counts, 0, sizeof(counts));
+        total = 0;
+        sum = 0;
+        minValue = UINT64_MAX;
+        maxValue = 0;
+    }
+
+    void record(uint64_t value) {
+        counts[bucketOf(value)]++;
+        total++;
+        sum += value;
+        if (value < minValue)
+            minValue = value;
+        if (value > maxValue)
+            maxValue = value;
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (int i = 0; i < NUM_BUCKETS; i++)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        if (other.minValue < minValue)
+            minValue = other.minValue;
+        if (other.maxValue > maxValue)
+            maxValue = other.maxValue;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total == 0 ? 0 : minValue; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return total == 0 ? 0.0 : static_cast<double>(sum) / total; }
+
+    // Smallest bucket upper bound covering fraction p (0.0 - 1.0) of the recorded values
+    uint64_t percentile(double p) const {
+        if (total == 0)
+            return 0;
+
+        uint64_t target = static_cast<uint64_t>(p * total + 0.5);
+        if (target == 0)
+            target = 1;
+
+        uint64_t seen = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= target) {
+                uint64_t upper = upperBound(i);
+                return upper < maxValue ? upper : maxValue;
+            }
+        }
+        return maxValue;
+    }
+
+private:
+    static int bucketOf(uint64_t value) {
+        if (value < static_cast<uint64_t>(SUB_BUCKETS))
+            return static_cast<int>(value);
+
+        int magnitude = 63 - __builtin_clzll(value);
+        int shift = magnitude - SUB_BUCKET_BITS;
+        int top = static_cast<int>(value >> shift);  // in [SUB_BUCKETS, 2 * SUB_BUCKETS)
+        return (shift + 1) * SUB_BUCKETS + (top - SUB_BUCKETS);
+    }
+
+    static uint64_t upperBound(int bucket) {
+        if (bucket < SUB_BUCKETS)
+            return static_cast<uint64_t>(bucket);
+
+        int shift = bucket / SUB_BUCKETS - 1;
+        uint64_t top = static_cast<uint64_t>(bucket % SUB_BUCKETS + SUB_BUCKETS);
+        return (top << shift) + ((1ULL << shift) - 1);
+    }
+
+    uint64_t counts[NUM_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t minValue;
+    uint64_t maxValue;
+};
+
+#endif
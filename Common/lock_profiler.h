@@ -0,0 +1,221 @@
+#ifndef LOCK_PROFILER_H
+#define LOCK_PROFILER_H
+
+// Per-lock contention profiling, enabled with -DLOCK_PROFILING.
+//
+// ProfiledMutex<M> wraps any mutex type (std::mutex, std::timed_mutex, TicketLock, ...) and counts
+// acquisitions, contended acquisitions and failed try_lock attempts, and records how long
+// contended acquisitions waited and how long the lock was held into LatencyHistograms. Every
+// thread records into its own buffers, which are merged into a global table when the thread
+// exits, so the hot path takes no shared lock. A report sorted by total wait time is printed to
+// stderr at program exit.
+//
+// Without LOCK_PROFILING, ProfiledMutex<M> is M itself and nameLock() is an empty inline
+// function, so profiled code compiles to exactly the unprofiled program. Condition variables
+// need std::condition_variable_any around a wrapped std::mutex; use ProfiledConditionVariable,
+// which is plain std::condition_variable when profiling is off
+
+#include <condition_variable>
+#include <mutex>
+
+#ifdef LOCK_PROFILING
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "histogram.h"
+
+
+struct LockStats {
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    uint64_t failedTries = 0;
+    LatencyHistogram wait;  // nanoseconds, contended acquisitions only
+    LatencyHistogram hold;  // nanoseconds
+
+    void merge(const LockStats &other) {
+        acquisitions += other.acquisitions;
+        contended += other.contended;
+        failedTries += other.failedTries;
+        wait.merge(other.wait);
+        hold.merge(other.hold);
+    }
+};
+
+
+// Names and merged statistics of every profiled lock, reported on destruction (at exit)
+class LockRegistry {
+public:
+    static LockRegistry &instance() {
+        static LockRegistry registry;
+        return registry;
+    }
+
+    int add() {
+        std::lock_guard<std::mutex> guard(mutex);
+        names.emplace_back("lock #" + std::to_string(names.size()));
+        totals.emplace_back();
+        return static_cast<int>(names.size()) - 1;
+    }
+
+    void setName(int id, const std::string &name) {
+        std::lock_guard<std::mutex> guard(mutex);
+        names[id] = name;
+    }
+
+    void merge(int id, const LockStats &stats) {
+        std::lock_guard<std::mutex> guard(mutex);
+        totals[id].merge(stats);
+    }
+
+    ~LockRegistry() {
+        std::vector<int> order;
+        for (size_t id = 0; id < totals.size(); id++)
+            if (totals[id].acquisitions > 0 || totals[id].failedTries > 0)
+                order.emplace_back(static_cast<int>(id));
+        std::sort(order.begin(), order.end(), [this](int a, int b) {
+            return totals[a].wait.mean() * totals[a].wait.count() > totals[b].wait.mean() * totals[b].wait.count();
+        });
+
+        fprintf(stderr, "\nLock profile (times in ns, wait percentiles over contended acquisitions)\n");
+        fprintf(stderr, "%-20s %10s %10s %8s %10s %10s %10s %12s %10s %10s %12s\n", "lock", "acquired", "contended",
+                "failed", "wait_p50", "wait_p99", "wait_max", "wait_total", "hold_p50", "hold_p99", "hold_max");
+        for (int id : order) {
+            const LockStats &s = totals[id];
+            fprintf(stderr, "%-20s %10lu %10lu %8lu %10lu %10lu %10lu %12.0f %10lu %10lu %12lu\n", names[id].c_str(),
+                    (unsigned long)s.acquisitions, (unsigned long)s.contended, (unsigned long)s.failedTries,
+                    (unsigned long)s.wait.percentile(0.50), (unsigned long)s.wait.percentile(0.99),
+                    (unsigned long)s.wait.max(), s.wait.mean() * s.wait.count(),
+                    (unsigned long)s.hold.percentile(0.50), (unsigned long)s.hold.percentile(0.99),
+                    (unsigned long)s.hold.max());
+        }
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::string> names;
+    std::deque<LockStats> totals;
+};
+
+
+// This thread's statistics, indexed by lock id and allocated on first use of each lock
+class ThreadLockStats {
+public:
+    static LockStats &of(int id) {
+        thread_local ThreadLockStats local;
+        if (id >= static_cast<int>(local.locks.size()))
+            local.locks.resize(id + 1);
+        if (!local.locks[id])
+            local.locks[id].reset(new LockStats());
+        return *local.locks[id];
+    }
+
+    ~ThreadLockStats() {
+        for (size_t id = 0; id < locks.size(); id++)
+            if (locks[id])
+                LockRegistry::instance().merge(static_cast<int>(id), *locks[id]);
+    }
+
+private:
+    ThreadLockStats() { LockRegistry::instance(); }  // registry must outlive every thread's buffers
+
+    std::vector<std::unique_ptr<LockStats>> locks;
+};
+
+
+inline uint64_t profilerNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+template <typename Mutex>
+class ProfiledMutex {
+public:
+    ProfiledMutex() : id(LockRegistry::instance().add()) {}
+    ProfiledMutex(const ProfiledMutex &) = delete;
+    ProfiledMutex &operator=(const ProfiledMutex &) = delete;
+
+    void lock() {
+        if (mutex.try_lock()) {
+            acquired(false, 0);
+            return;
+        }
+        uint64_t start = profilerNowNs();
+        mutex.lock();
+        acquired(true, profilerNowNs() - start);
+    }
+
+    bool try_lock() {
+        if (mutex.try_lock()) {
+            acquired(false, 0);
+            return true;
+        }
+        ThreadLockStats::of(id).failedTries++;
+        return false;
+    }
+
+    template <typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout) {
+        if (mutex.try_lock()) {
+            acquired(false, 0);
+            return true;
+        }
+        uint64_t start = profilerNowNs();
+        if (mutex.try_lock_for(timeout)) {
+            acquired(true, profilerNowNs() - start);
+            return true;
+        }
+        ThreadLockStats::of(id).failedTries++;
+        return false;
+    }
+
+    void unlock() {
+        ThreadLockStats::of(id).hold.record(profilerNowNs() - holdStart);
+        mutex.unlock();
+    }
+
+    void setName(const std::string &name) { LockRegistry::instance().setName(id, name); }
+
+private:
+    void acquired(bool contended, uint64_t waitNs) {
+        LockStats &stats = ThreadLockStats::of(id);
+        stats.acquisitions++;
+        if (contended) {
+            stats.contended++;
+            stats.wait.record(waitNs);
+        }
+        holdStart = profilerNowNs();  // only the owner writes this
+    }
+
+    Mutex mutex;
+    int id;
+    uint64_t holdStart = 0;
+};
+
+typedef std::condition_variable_any ProfiledConditionVariable;
+
+// Label a lock in the report, e.g. nameLock(chopsticks[i], "chopstick", i)
+template <typename Mutex>
+void nameLock(ProfiledMutex<Mutex> &lock, const char *name, int index = -1) {
+    lock.setName(index < 0 ? std::string(name) : std::string(name) + ' ' + std::to_string(index));
+}
+
+#else
+
+template <typename Mutex>
+using ProfiledMutex = Mutex;
+
+typedef std::condition_variable ProfiledConditionVariable;
+
+template <typename Mutex>
+inline void nameLock(Mutex &, const char *, int = -1) {}
+
+#endif
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// NUMA nodes and the CPUs on each, read once from sysfs. Nodes are numbered 0..nodes()-1 here and
+// only those with CPUs count: memory-only nodes are left out, and a gap in the kernel's numbering
+// doesn't shift or hide the nodes after it (systemNode() gives the kernel's number back). Without
+// NUMA information the machine is a single node holding every online CPU
+class NumaTopology {
+public:
+    static const NumaTopology &instance() {
+        static NumaTopology topology;
+        return topology;
+    }
+
+    int nodes() const { return static_cast<int>(nodeCpus.size()); }
+    const std::vector<int> &cpusOf(int node) const { return nodeCpus[node]; }
+
+    // The kernel's number for a node, as mbind and sysfs want it; -1 without NUMA information
+    int systemNode(int node) const {
+        return (node >= 0 && node < static_cast<int>(nodeIds.size())) ? nodeIds[node] : -1;
+    }
+
+    int nodeOf(int cpu) const {
+        return (cpu >= 0 && cpu < static_cast<int>(cpuNode.size())) ? cpuNode[cpu] : 0;
+    }
+
+private:
+    NumaTopology() {
+        for (int id : systemNodeIds()) {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string list;
+            if (!file || !std::getline(file, list))
+                continue;
+            std::vector<int> cpus = parseCpuList(list);
+            if (cpus.empty())
+                continue;  // memory only
+            nodeIds.emplace_back(id);
+            nodeCpus.emplace_back(cpus);
+        }
+
+        if (nodeCpus.empty()) {
+            nodeIds.clear();
+            nodeCpus.emplace_back();
+            for (int cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN); cpu++)
+                nodeCpus.back().emplace_back(cpu);
+        }
+
+        for (int node = 0; node < nodes(); node++) {
+            for (int cpu : nodeCpus[node]) {
+                if (cpu >= static_cast<int>(cpuNode.size()))
+                    cpuNode.resize(cpu + 1, 0);
+                cpuNode[cpu] = node;
+            }
+        }
+    }
+
+    // Every nodeN directory in sysfs, in ascending order
+    static std::vector<int> systemNodeIds() {
+        std::vector<int> ids;
+        DIR *dir = opendir("/sys/devices/system/node");
+        if (dir == nullptr)
+            return ids;
+        while (struct dirent *entry = readdir(dir)) {
+            int id;
+            char rest;
+            if (sscanf(entry->d_name, "node%d%c", &id, &rest) == 1 && id >= 0)
+                ids.emplace_back(id);
+        }
+        closedir(dir);
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    // Parse a sysfs cpulist such as "0-3,8-11"
+    static std::vector<int> parseCpuList(const std::string &list) {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            size_t dash = range.find('-');
+            int first = atoi(range.c_str());
+            int last = (dash == std::string::npos) ? first : atoi(range.c_str() + dash + 1);
+            for (int cpu = first; cpu <= last; cpu++)
+                cpus.emplace_back(cpu);
+        }
+        return cpus;
+    }
+
+    std::vector<int> nodeIds;
+    std::vector<std::vector<int>> nodeCpus;
+    std::vector<int> cpuNode;
+};
+
+
+// Node of the CPU the calling thread is running on right now (sched_getcpu is a vDSO call)
+inline int currentNumaNode() {
+    return NumaTopology::instance().nodeOf(sched_getcpu());
+}
+
+
+// Allocator placing memory on one NUMA node, for containers that are written by threads of one
+// node but read by another, such as the ring of a bounded buffer whose consumer sits across the
+// interconnect. Every allocation is its own mapping with a preferred-node policy set before first
+// touch, so it suits a few long-lived buffers rather than many small objects. node is a NumaTopology
+// node; -1 (or a failing mbind) leaves the default first-touch placement
+template <typename T>
+class NodeAllocator {
+public:
+    typedef T value_type;
+
+    explicit NodeAllocator(int node = -1) : node(node) {}
+
+    template <typename U>
+    NodeAllocator(const NodeAllocator<U> &other) : node(other.node) {}
+
+    T *allocate(size_t n) {
+        size_t bytes = mappedBytes(n);
+        void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+        int id = NumaTopology::instance().systemNode(node);
+        if (id >= 0 && id < static_cast<int>(sizeof(unsigned long) * 8)) {
+            unsigned long nodeMask = 1UL << id;
+            syscall(SYS_mbind, p, bytes, MPOL_PREFERRED, &nodeMask, sizeof(nodeMask) * 8, 0);
+        }
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T *p, size_t n) {
+        munmap(p, mappedBytes(n));
+    }
+
+    int node;
+
+private:
+    static size_t mappedBytes(size_t n) {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t bytes = n * sizeof(T);
+        return bytes == 0 ? page : (bytes + page - 1) / page * page;
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const NodeAllocator<T> &a, const NodeAllocator<U> &b) { return a.node == b.node; }
+
+template <typename T, typename U>
+bool operator!=(const NodeAllocator<T> &a, const NodeAllocator<U> &b) { return a.node != b.node; }
+
+#endif
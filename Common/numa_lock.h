@@ -0,0 +1,103 @@
+#ifndef NUMA_LOCK_H
+#define NUMA_LOCK_H
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "numa.h"
+#include "ticket_lock.h"
+
+
+const int COHORT_MAX_HANDOFFS = 64;  // default fairness bound, see CohortLock
+
+
+// NUMA-aware cohort lock (a global ticket lock over one ticket lock per node). A thread first
+// queues on its node's local lock; the first of a node to get it also takes the global lock. On
+// unlock, if another thread of the same node is already queued, ownership of the global lock is
+// passed to it along with the local lock, so the lock word and the data it protects stay in that
+// node's caches instead of crossing the interconnect on every acquisition. After maxHandoffs
+// consecutive local hand-offs the global lock is released anyway, which bounds how long other
+// nodes can be kept waiting. Both levels are FIFO, so no thread starves.
+//
+// Both levels are TicketLocks, so waiters spin for a while and then park, and a lock held for long
+// (a cart owner waiting on a condition variable) costs its waiters no CPU. Like any FIFO lock it
+// still prefers a core per thread: oversubscribed, every hand-off to a preempted waiter stalls the
+// queue until it runs again, where std::mutex lets whoever is running barge in. Provides
+// lock/unlock/try_lock/try_lock_for, so it can stand in for std::timed_mutex (through
+// std::condition_variable_any)
+class CohortLock {
+public:
+    explicit CohortLock(int maxHandoffs = COHORT_MAX_HANDOFFS)
+        : maxHandoffs(maxHandoffs), cohorts(NumaTopology::instance().nodes()) {}
+
+    CohortLock(const CohortLock&) = delete;
+    CohortLock &operator=(const CohortLock&) = delete;
+
+    void lock() {
+        int node = currentNumaNode();
+        Cohort &cohort = cohorts[node];
+        cohort.local.lock();
+
+        // ownsGlobal is only touched by holders of the local lock
+        if (!cohort.ownsGlobal)
+            global.lock();
+        holder = node;
+    }
+
+    bool try_lock() {
+        int node = currentNumaNode();
+        Cohort &cohort = cohorts[node];
+        if (!cohort.local.try_lock())
+            return false;
+        if (!cohort.ownsGlobal && !global.try_lock()) {
+            cohort.local.unlock();
+            return false;
+        }
+        holder = node;
+        return true;
+    }
+
+    // A ticket can't be handed back, so timed attempts poll try_lock() with exponential back-off
+    template <typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        auto pause = std::chrono::microseconds(1);
+        while (!try_lock()) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::sleep_for(pause);
+            if (pause < std::chrono::microseconds(1000))
+                pause *= 2;
+        }
+        return true;
+    }
+
+    // The unlocking thread may have migrated, so the cohort is the one recorded by lock()
+    void unlock() {
+        Cohort &cohort = cohorts[holder];
+        if (cohort.local.hasWaiters() && cohort.handoffs < maxHandoffs) {
+            cohort.handoffs++;
+            cohort.ownsGlobal = true;
+        } else {
+            cohort.handoffs = 0;
+            cohort.ownsGlobal = false;
+            global.unlock();
+        }
+        cohort.local.unlock();
+    }
+
+private:
+    // Local lock and hand-off state of one node, written only by that node's threads
+    struct alignas(64) Cohort {
+        TicketLock local;
+        bool ownsGlobal = false;
+        int handoffs = 0;
+    };
+
+    int maxHandoffs;
+    std::vector<Cohort> cohorts;
+    TicketLock global;
+    alignas(64) int holder = 0;  // node of the current owner
+};
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// Hardware and software counters around a measured region, for benchmark reports:
+//
+//   PerfCounters counters;
+//   counters.start();
+//   ... run, including threads or child processes that finish before stop() ...
+//   PerfSample sample = counters.stop();
+//   std::cout << row << sample.csv(operations) << std::endl;  // header: perfCsvHeader()
+//
+// Counters are opened per event with perf_event_open for the calling thread and inherited by the
+// threads and processes it creates afterwards. Hardware events count user space only, so they work
+// at the default perf_event_paranoid level. Each event falls back on its own when it can't be opened
+// (no PMU in a VM, perf disabled in a container, seccomp, paranoid level): context switches and page
+// faults come from getrusage() of the process and its waited-for children, the hardware events stay
+// empty in the report. When more events are open than the PMU has counters, the kernel multiplexes
+// them and values are scaled by the share of time each event was actually counting
+
+enum PerfEvent { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_CACHE_MISSES, PERF_BRANCH_MISSES, PERF_CONTEXT_SWITCHES,
+                 PERF_PAGE_FAULTS, NUM_PERF_EVENTS };
+
+const char *const PERF_EVENT_NAMES[NUM_PERF_EVENTS] = {"cycles", "instructions", "cache_misses", "branch_misses",
+                                                       "context_switches", "page_faults"};
+
+
+// CSV columns of PerfSample::csv(), each with its leading comma
+inline std::string perfCsvHeader() {
+    std::string header;
+    for (int e = 0; e < NUM_PERF_EVENTS; e++)
+        header += std::string(",") + PERF_EVENT_NAMES[e];
+    header += ",ipc";
+    for (int e = 0; e < NUM_PERF_EVENTS; e++)
+        header += std::string(",") + PERF_EVENT_NAMES[e] + "_per_op";
+    return header;
+}
+
+
+struct PerfSample {
+    uint64_t values[NUM_PERF_EVENTS] = {};
+    bool valid[NUM_PERF_EVENTS] = {};
+
+    // Totals, instructions per cycle, then every event divided by operations. Unavailable events
+    // are empty fields
+    std::string csv(uint64_t operations) const {
+        std::ostringstream out;
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            out << ',';
+            if (valid[e])
+                out << values[e];
+        }
+        out << ',';
+        if (valid[PERF_CYCLES] && valid[PERF_INSTRUCTIONS] && values[PERF_CYCLES] > 0)
+            out << static_cast<double>(values[PERF_INSTRUCTIONS]) / values[PERF_CYCLES];
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            out << ',';
+            if (valid[e] && operations > 0)
+                out << static_cast<double>(values[e]) / operations;
+        }
+        return out.str();
+    }
+};
+
+
+class PerfCounters {
+public:
+    PerfCounters() {
+        static const uint32_t types[NUM_PERF_EVENTS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                        PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE, PERF_TYPE_SOFTWARE};
+        static const uint64_t configs[NUM_PERF_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                          PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+                                                          PERF_COUNT_SW_CONTEXT_SWITCHES, PERF_COUNT_SW_PAGE_FAULTS};
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[e];
+            attr.config = configs[e];
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = types[e] == PERF_TYPE_HARDWARE;  // switches and faults happen in the kernel
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[e] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        }
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds)
+            if (fd != -1)
+                close(fd);
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters &operator=(const PerfCounters&) = delete;
+
+    // True if at least one hardware event could be opened
+    bool hardwareAvailable() const {
+        return fds[PERF_CYCLES] != -1 || fds[PERF_INSTRUCTIONS] != -1 || fds[PERF_CACHE_MISSES] != -1 ||
+               fds[PERF_BRANCH_MISSES] != -1;
+    }
+
+    // May be called again after stop() to measure another region. RESET doesn't clear what the
+    // counters have already folded in from exited threads and children, so every region is measured
+    // as the difference to a reading taken here
+    void start() {
+        usageBefore = usage();
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            if (fds[e] == -1)
+                continue;
+            ioctl(fds[e], PERF_EVENT_IOC_RESET, 0);
+            if (!readCounter(fds[e], before[e])) {
+                close(fds[e]);
+                fds[e] = -1;
+                continue;
+            }
+            ioctl(fds[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    PerfSample stop() {
+        PerfSample sample;
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            if (fds[e] == -1)
+                continue;
+            ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+
+            uint64_t data[3];
+            if (!readCounter(fds[e], data))
+                continue;
+            for (int i = 0; i < 3; i++)
+                data[i] -= before[e][i];
+            if (data[2] == 0)
+                continue;
+            sample.values[e] = data[2] < data[1] ? static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2])
+                                                 : data[0];
+            sample.valid[e] = true;
+        }
+
+        Usage after = usage();
+        if (!sample.valid[PERF_CONTEXT_SWITCHES]) {
+            sample.values[PERF_CONTEXT_SWITCHES] = after.contextSwitches - usageBefore.contextSwitches;
+            sample.valid[PERF_CONTEXT_SWITCHES] = true;
+        }
+        if (!sample.valid[PERF_PAGE_FAULTS]) {
+            sample.values[PERF_PAGE_FAULTS] = after.pageFaults - usageBefore.pageFaults;
+            sample.valid[PERF_PAGE_FAULTS] = true;
+        }
+        return sample;
+    }
+
+private:
+    struct Usage {
+        uint64_t contextSwitches = 0;
+        uint64_t pageFaults = 0;
+    };
+
+    // Value, time enabled, time running
+    static bool readCounter(int fd, uint64_t data[3]) {
+        return read(fd, data, 3 * sizeof(uint64_t)) == static_cast<ssize_t>(3 * sizeof(uint64_t));
+    }
+
+    static Usage usage() {
+        Usage total;
+        for (int who : {RUSAGE_SELF, RUSAGE_CHILDREN}) {
+            struct rusage ru;
+            if (getrusage(who, &ru) == 0) {
+                total.contextSwitches += static_cast<uint64_t>(ru.ru_nvcsw + ru.ru_nivcsw);
+                total.pageFaults += static_cast<uint64_t>(ru.ru_minflt + ru.ru_majflt);
+            }
+        }
+        return total;
+    }
+
+    int fds[NUM_PERF_EVENTS];
+    uint64_t before[NUM_PERF_EVENTS][3] = {};
+    Usage usageBefore;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef TICKET_LOCK_H
+#define TICKET_LOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include "cpu_relax.h"
+
+
+// FIFO ticket lock with adaptive spin-then-park waiting. A waiter spins for a while (the hand-off
+// is often only a few hundred nanoseconds away) and then sleeps on the futex behind
+// std::atomic::wait. The spin budget grows when spinning pays off and shrinks when it doesn't
+class TicketLock {
+public:
+    void lock() {
+        uint32_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+        waitForTurn(ticket);
+    }
+
+    bool try_lock() {
+        uint32_t ticket = next.load(std::memory_order_relaxed);
+        if (serving.load(std::memory_order_acquire) != ticket)
+            return false;
+        return next.compare_exchange_strong(ticket, ticket + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    // A ticket can't be handed back, so timed attempts poll try_lock() with exponential back-off
+    // instead of queueing. Queue fairness only applies to lock()
+    template <typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        auto pause = std::chrono::microseconds(1);
+        while (!try_lock()) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::sleep_for(pause);
+            if (pause < std::chrono::microseconds(1000))
+                pause *= 2;
+        }
+        return true;
+    }
+
+    // Whether another thread has queued behind the holder; only meaningful to the holder
+    bool hasWaiters() const {
+        return next.load(std::memory_order_relaxed) != serving.load(std::memory_order_relaxed) + 1;
+    }
+
+    void unlock() {
+        serving.fetch_add(1, std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_seq_cst) > 0)
+            serving.notify_all();  // parked waiters re-check their own ticket
+    }
+
+private:
+    static const int MIN_SPINS = 16;
+    static const int MAX_SPINS = 4096;
+
+    void waitForTurn(uint32_t ticket) {
+        int budget = spinBudget.load(std::memory_order_relaxed);
+        for (int i = 0; i < budget; i++) {
+            if (serving.load(std::memory_order_acquire) == ticket) {
+                if (budget < MAX_SPINS)
+                    spinBudget.store(budget * 2, std::memory_order_relaxed);
+                return;
+            }
+            cpuRelax();
+        }
+
+        if (budget > MIN_SPINS)
+            spinBudget.store(budget / 2, std::memory_order_relaxed);
+
+        parked.fetch_add(1, std::memory_order_seq_cst);
+        uint32_t current;
+        while ((current = serving.load(std::memory_order_acquire)) != ticket)
+            serving.wait(current, std::memory_order_acquire);
+        parked.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    alignas(64) std::atomic<uint32_t> next{0};
+    alignas(64) std::atomic<uint32_t> serving{0};
+    std::atomic<int> parked{0};
+    std::atomic<int> spinBudget{256};
+};
+
+#endif
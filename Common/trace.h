@@ -0,0 +1,304 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timeline tracing in Chrome Trace Event format, enabled with -DEVENT_TRACING. Open the output in
+// chrome://tracing or ui.perfetto.dev.
+//
+// Every thread records timestamped events into its own lock-free ring; a background thread drains
+// the rings every few milliseconds and writes them to the trace file, so the traced code never
+// formats text or makes a system call. Timestamps come from steady_clock (CLOCK_MONOTONIC), which
+// forked processes share, so parent and children line up on one timeline without calibration.
+// The file is opened with O_APPEND and written in the JSON array form (no closing bracket needed),
+// so forked children append to it directly. A child has no flusher thread; its events are written
+// when its ring fills up, at TRACE_FLUSH() and when it returns from main.
+//
+//   TRACE_START("run.trace.json");     // once, in main
+//   TRACE_THREAD_NAME("astronomer", i);
+//   TRACE_SCOPE("eat");                // begin here, end at the end of the block
+//   TRACE_BEGIN("think"); ... TRACE_END("think");
+//   TRACE_INSTANT("dispatch", pid);    // point event with an integer argument
+//   TRACE_COUNTER("cart fill", n);     // plotted as a counter track
+//   TRACE_STOP();
+//
+// Event names must be string literals (only the pointer is recorded). Without EVENT_TRACING every
+// macro expands to nothing (values only appear in an unevaluated sizeof, to keep variables used)
+
+#ifdef EVENT_TRACING
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+const int TRACE_FLUSH_INTERVAL_MS = 20;  // how often the flusher thread drains the rings
+
+struct TraceEvent {
+    uint64_t timestamp;  // steady_clock nanoseconds
+    const char *name;
+    int64_t value;
+    char phase;  // 'B', 'E', 'i' (with value) or 'C' (counter value)
+};
+
+
+// Single producer (the owning thread), single consumer (whoever holds the tracer's mutex)
+struct TraceRing {
+    static const uint32_t CAPACITY = 4096;
+
+    alignas(64) std::atomic<uint32_t> head{0};  // written by the owner
+    alignas(64) std::atomic<uint32_t> tail{0};  // written by the drainer
+    TraceEvent events[CAPACITY];
+
+    long tid = 0;
+    std::string threadName;
+    bool nameWritten = false;
+    uint64_t dropped = 0;
+};
+
+
+class Tracer {
+public:
+    // Never destroyed: a forked child inherits the condition variable the parent's flusher waits
+    // on, and destroying it there would wait forever for that (non-existent) waiter
+    static Tracer &instance() {
+        static Tracer *tracer = new Tracer();
+        return *tracer;
+    }
+
+    static uint64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool start(const char *path) {
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        if (fd < 0) {
+            perror("trace file");
+            return false;
+        }
+        if (write(fd, "[\n", 2) != 2)
+            return false;
+
+        pid = getpid();
+        if (!exitHandlers) {
+            pthread_atfork(lockForFork, unlockAfterFork, resetInChild);
+            atexit(stopAtExit);  // also runs in children that return from main
+            exitHandlers = true;
+        }
+        flusher.reset(new std::thread(&Tracer::flushLoop, this));
+        background.store(true, std::memory_order_relaxed);
+        active.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void stop() {
+        if (!active.exchange(false))
+            return;
+        background.store(false, std::memory_order_relaxed);
+        if (flusher) {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            flusher->join();
+            flusher.reset();
+        }
+        flush();
+
+        // Threads recording their first event append to rings under the mutex
+        uint64_t dropped = 0;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            close(fd);
+            fd = -1;
+            for (TraceRing *ring : rings)
+                dropped += ring->dropped;
+        }
+        if (dropped > 0)
+            fprintf(stderr, "trace: %lu events dropped (rings full), raise TraceRing::CAPACITY\n", (unsigned long)dropped);
+    }
+
+    void record(char phase, const char *name, int64_t value = 0) {
+        if (!active.load(std::memory_order_relaxed))
+            return;
+
+        TraceRing &ring = localRing();
+        uint32_t head = ring.head.load(std::memory_order_relaxed);
+        if (head - ring.tail.load(std::memory_order_acquire) == TraceRing::CAPACITY) {
+            if (background.load(std::memory_order_relaxed)) {
+                ring.dropped++;  // never block the traced code on the flusher
+                return;
+            }
+            flush();  // forked child: nobody else will drain the ring
+        }
+
+        ring.events[head % TraceRing::CAPACITY] = TraceEvent{nowNs(), name, value, phase};
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    void setThreadName(const std::string &name) {
+        TraceRing &ring = localRing();
+        std::lock_guard<std::mutex> guard(mutex);
+        ring.threadName = name;
+        ring.nameWritten = false;
+    }
+
+    // Drain every ring into the file
+    void flush() {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (fd < 0)
+            return;
+
+        std::string out;
+        char line[256];
+        for (TraceRing *ring : rings) {
+            if (!ring->nameWritten && !ring->threadName.empty()) {
+                snprintf(line, sizeof(line),
+                         "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":\"%s\"}},\n",
+                         pid, ring->tid, ring->threadName.c_str());
+                out += line;
+                ring->nameWritten = true;
+            }
+
+            uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint32_t head = ring->head.load(std::memory_order_acquire);
+            for (; tail != head; tail++) {
+                const TraceEvent &event = ring->events[tail % TraceRing::CAPACITY];
+                formatEvent(event, ring->tid, line, sizeof(line));
+                out += line;
+            }
+            ring->tail.store(tail, std::memory_order_release);
+        }
+
+        // One write per flush: with O_APPEND, lines from different processes never interleave
+        if (!out.empty() && write(fd, out.data(), out.size()) < 0)
+            perror("trace write");
+    }
+
+private:
+    TraceRing &localRing() {
+        thread_local TraceRing *ring = nullptr;
+        if (!ring) {
+            ring = new TraceRing();  // owned by the tracer, drained even after the thread exits
+            ring->tid = syscall(SYS_gettid);
+            std::lock_guard<std::mutex> guard(mutex);
+            rings.push_back(ring);
+        }
+        return *ring;
+    }
+
+    void formatEvent(const TraceEvent &event, long tid, char *line, size_t size) const {
+        double us = event.timestamp / 1000.0;
+        switch (event.phase) {
+            case 'i':
+                snprintf(line, size, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%d,\"tid\":%ld,"
+                         "\"args\":{\"value\":%lld}},\n", event.name, us, pid, tid, (long long)event.value);
+                break;
+            case 'C':
+                snprintf(line, size, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%d,\"args\":{\"value\":%lld}},\n",
+                         event.name, us, pid, (long long)event.value);
+                break;
+            default:
+                snprintf(line, size, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%ld},\n",
+                         event.name, event.phase, us, pid, tid);
+        }
+    }
+
+    void flushLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            wake.wait_for(lock, std::chrono::milliseconds(TRACE_FLUSH_INTERVAL_MS));
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    static void stopAtExit() { instance().stop(); }
+
+    // fork() while the flusher holds the mutex would leave it locked forever in the child
+    static void lockForFork() { instance().mutex.lock(); }
+    static void unlockAfterFork() { instance().mutex.unlock(); }
+
+    // The child inherits copies of the parent's rings. Their pending events are the parent's to
+    // write, so drop them, and forget the flusher thread, which doesn't exist in the child
+    static void resetInChild() {
+        Tracer &tracer = instance();
+        tracer.mutex.unlock();
+        tracer.flusher.release();  // leaked on purpose: destroying a joinable std::thread terminates
+        tracer.background.store(false, std::memory_order_relaxed);
+        tracer.pid = getpid();
+        for (TraceRing *ring : tracer.rings) {
+            ring->tail.store(ring->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            ring->nameWritten = false;
+        }
+        tracer.localRing().tid = syscall(SYS_gettid);
+    }
+
+    std::atomic<bool> active{false};
+    std::atomic<bool> background{false};  // a flusher thread drains the rings in this process
+    int fd = -1;
+    int pid = 0;
+    std::mutex mutex;  // guards rings, thread names and the file
+    std::condition_variable wake;
+    bool stopping = false;
+    bool exitHandlers = false;
+    std::vector<TraceRing*> rings;
+    std::unique_ptr<std::thread> flusher;
+};
+
+
+// Records a begin event now and the matching end event when the scope exits
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) : name(name) { Tracer::instance().record('B', name); }
+    ~TraceScope() { Tracer::instance().record('E', name); }
+
+private:
+    const char *name;
+};
+
+inline void traceThreadName(const char *name, int index = -1) {
+    Tracer::instance().setThreadName(index < 0 ? std::string(name) : std::string(name) + ' ' + std::to_string(index));
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#define TRACE_START(path) Tracer::instance().start(path)
+#define TRACE_STOP() Tracer::instance().stop()
+#define TRACE_FLUSH() Tracer::instance().flush()
+#define TRACE_THREAD_NAME(...) traceThreadName(__VA_ARGS__)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_BEGIN(name) Tracer::instance().record('B', name)
+#define TRACE_END(name) Tracer::instance().record('E', name)
+#define TRACE_INSTANT(name, value) Tracer::instance().record('i', name, value)
+#define TRACE_COUNTER(name, value) Tracer::instance().record('C', name, value)
+
+#else
+
+#define TRACE_START(path)
+#define TRACE_STOP()
+#define TRACE_FLUSH()
+#define TRACE_THREAD_NAME(...)
+#define TRACE_SCOPE(name)
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#define TRACE_INSTANT(name, value) ((void)sizeof(value))
+#define TRACE_COUNTER(name, value) ((void)sizeof(value))
+
+#endif
+
+#endif
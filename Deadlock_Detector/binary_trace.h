@@ -0,0 +1,87 @@
+#ifndef BINARY_TRACE_H
+#define BINARY_TRACE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+
+// Compact binary form of a deadlock detector trace ("R1 -> A" / "R1 <- A" lines):
+//
+//   header      fixed size, see below
+//   records     one per edge, in trace order
+//   dictionary  every node name, in node id order
+//
+// Nodes are numbered in order of first appearance, robot before resource within a line, which is
+// the numbering detect_deadlock() gives them, so both paths report robots in the same order.
+// A record is two varints: zigzag(robot - previous robot) << 1 | is_request, then
+// zigzag(resource - previous resource). Traces revisit recent robots and resources, so most
+// deltas fit in one or two bytes. A dictionary entry is varint(length << 1 | is_resource) followed
+// by the name bytes. The dictionary comes last so a converter can stream records without knowing
+// the node count up front
+
+const char BINARY_TRACE_MAGIC[8] = {'D', 'L', 'T', 'R', 'A', 'C', 'E', '1'};
+
+struct BinaryTraceHeader {
+    char magic[8];
+    uint64_t num_records;
+    uint64_t num_names;
+    uint64_t records_offset;
+    uint64_t names_offset;
+    uint64_t file_size;
+};
+
+
+inline uint64_t zigzag_encode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Append value as a little-endian base-128 varint; returns the number of bytes written (max 10)
+inline int put_varint(uint8_t *out, uint64_t value) {
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+// Decode a varint at p, advancing it. Returns false on a truncated or overlong varint
+inline bool get_varint(const uint8_t *&p, const uint8_t *end, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Check a header against the size of the file it came from before trusting its counts: the
+// sections must lie in the file in order (records, then dictionary), and every record takes at
+// least two bytes and every dictionary entry at least one, so neither count can claim more
+// entries than its section has room for
+inline bool valid_binary_trace_header(const BinaryTraceHeader &header, uint64_t size) {
+    if (memcmp(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic)) != 0 || header.file_size != size)
+        return false;
+    if (header.records_offset < sizeof(header) || header.records_offset > header.names_offset ||
+        header.names_offset > size)
+        return false;
+    return header.num_records <= (header.names_offset - header.records_offset) / 2 &&
+           header.num_names <= size - header.names_offset;
+}
+
+
+struct Result;
+
+// Run detect_deadlock() on a binary trace file, read through mmap. Returns false if the file can't
+// be mapped or isn't a valid trace
+bool detect_deadlock_file(const char *path, Result &result);
+
+#endif
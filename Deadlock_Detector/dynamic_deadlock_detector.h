@@ -0,0 +1,213 @@
+#ifndef DYNAMIC_DEADLOCK_DETECTOR_H
+#define DYNAMIC_DEADLOCK_DETECTOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "common.h"
+
+
+// Fully dynamic wait-for graph. Unlike detect_deadlock(), which only ever adds edges and re-sorts the
+// whole graph after each one, this detector takes a continuous stream of lock events:
+//
+//   robot -> resource     request (robot waits for resource)
+//   robot <- resource     assignment; also removes the robot's pending request for it, if any
+//   robot !-> resource    request withdrawn (timed out, cancelled)
+//   robot !<- resource    release
+//
+// Removing an edge never creates a cycle, so deletions cost a scan of one node's out-list. Adding
+// u -> v creates a cycle exactly when v already reaches u, so each insertion runs a DFS from v that
+// stops at u. In lock traces a robot waits for at most one resource and a resource has few holders,
+// so that search follows a short chain and stays local however many edges are live.
+//
+// With a window of W events, edges added more than W events ago expire, which keeps the graph
+// bounded on endless streams where some releases are never logged
+class DynamicDeadlockDetector {
+public:
+    enum class Op { REQUEST, ASSIGN, WITHDRAW, RELEASE, INVALID };
+
+    explicit DynamicDeadlockDetector(size_t window = 0) : window(window) {}
+
+    static Op parseOp(const std::string &arrow) {
+        if (arrow == "->") return Op::REQUEST;
+        if (arrow == "<-") return Op::ASSIGN;
+        if (arrow == "!->") return Op::WITHDRAW;
+        if (arrow == "!<-") return Op::RELEASE;
+        return Op::INVALID;
+    }
+
+    // Apply one "robot op resource" line. Returns true if the event closed a cycle, in which case
+    // the robots on it are stored in cycle
+    bool apply(const std::string &line, std::vector<std::string> &cycle) {
+        std::vector<std::string> e = split(line);
+        if (e.size() != 3)
+            return false;
+        return apply(e[0], parseOp(e[1]), e[2], cycle);
+    }
+
+    bool apply(const std::string &robotName, Op op, const std::string &resourceName, std::vector<std::string> &cycle) {
+        events++;
+        expire();
+
+        int robot = node(robotName, robotName);
+        int resource = node(resourceName + "$", "$");
+
+        switch (op) {
+            case Op::REQUEST:
+                return addEdge(robot, resource, cycle);
+            case Op::ASSIGN:
+                removeEdge(robot, resource);  // the request, if it was logged, has been granted
+                return addEdge(resource, robot, cycle);
+            case Op::WITHDRAW:
+                removeEdge(robot, resource);
+                return false;
+            case Op::RELEASE:
+                removeEdge(resource, robot);
+                return false;
+            case Op::INVALID:
+                break;
+        }
+        return false;
+    }
+
+    size_t liveEdges() const { return live; }
+    size_t nodes() const { return names.size(); }
+
+private:
+    struct Edge {
+        int from;
+        int to;
+        bool alive;
+    };
+
+    int node(const std::string &key, const std::string &name) {
+        int id = w2i.get(key);
+        if (id >= static_cast<int>(names.size())) {
+            names.resize(id + 1);
+            out.resize(id + 1);
+            visited.resize(id + 1, 0);
+            parentEdge.resize(id + 1, -1);
+            names[id] = name;
+        }
+        return id;
+    }
+
+    bool addEdge(int from, int to, std::vector<std::string> &cycle) {
+        int id;
+        if (!freeEdges.empty()) {
+            id = freeEdges.back();
+            freeEdges.pop_back();
+            edges[id] = Edge{from, to, true};
+        } else {
+            id = static_cast<int>(edges.size());
+            edges.push_back(Edge{from, to, true});
+        }
+        out[from].emplace_back(id);
+        live++;
+        if (window > 0)
+            windowEdges.emplace_back(events, id);
+
+        return findCycle(from, id, cycle);
+    }
+
+    // Remove one live from -> to edge. Returns false if there was none
+    bool removeEdge(int from, int to) {
+        std::vector<int> &list = out[from];
+        for (size_t i = 0; i < list.size(); i++) {
+            if (edges[list[i]].to == to) {
+                dropEdge(list, i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void dropEdge(std::vector<int> &list, size_t i) {
+        int id = list[i];
+        list[i] = list.back();
+        list.pop_back();
+        edges[id].alive = false;
+        live--;
+        if (window == 0)
+            freeEdges.emplace_back(id);  // in window mode the id is recycled when it leaves the window
+    }
+
+    void expire() {
+        while (!windowEdges.empty() && windowEdges.front().first + window <= events) {
+            int id = windowEdges.front().second;
+            windowEdges.pop_front();
+            if (edges[id].alive) {
+                std::vector<int> &list = out[edges[id].from];
+                for (size_t i = 0; i < list.size(); i++) {
+                    if (list[i] == id) {
+                        dropEdge(list, i);
+                        break;
+                    }
+                }
+            }
+            freeEdges.emplace_back(id);
+        }
+    }
+
+    // Does the head of the new edge reach its tail? DFS from edges[added].to, remembering the edge
+    // each node was reached by so the cycle can be read back
+    bool findCycle(int from, int added, std::vector<std::string> &cycle) {
+        if (++stamp == 0) {  // stamps wrapped, forget every old mark
+            std::fill(visited.begin(), visited.end(), 0);
+            stamp = 1;
+        }
+
+        int start = edges[added].to;
+        stack.clear();
+        stack.emplace_back(start);
+        visited[start] = stamp;
+        parentEdge[start] = added;
+
+        while (!stack.empty()) {
+            int n = stack.back();
+            stack.pop_back();
+            if (n == from) {
+                cycle.clear();
+                int current = from;
+                do {
+                    if (names[current] != "$")
+                        cycle.emplace_back(names[current]);
+                    current = edges[parentEdge[current]].from;
+                } while (current != from);
+                std::reverse(cycle.begin(), cycle.end());  // in wait-for order
+                return true;
+            }
+
+            for (int id : out[n]) {
+                int next = edges[id].to;
+                if (visited[next] != stamp) {
+                    visited[next] = stamp;
+                    parentEdge[next] = id;
+                    stack.emplace_back(next);
+                }
+            }
+        }
+        return false;
+    }
+
+    Word2Int w2i;
+    size_t window;
+    uint64_t events = 0;
+    size_t live = 0;
+
+    std::vector<std::string> names;  // robot name, "$" for resources
+    std::vector<std::vector<int>> out;  // ids of each node's live outgoing edges
+    std::vector<Edge> edges;
+    std::vector<int> freeEdges;
+    std::deque<std::pair<uint64_t, int>> windowEdges;  // (event it was added at, edge id)
+
+    // DFS scratch space, reused so a search only touches the nodes it visits
+    std::vector<uint32_t> visited;
+    std::vector<int> parentEdge;
+    std::vector<int> stack;
+    uint32_t stamp = 0;
+};
+
+#endif
@@ -3,57 +3,235 @@
 #include <unordered_map>
 #include <vector>
 #include <iostream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "common.h"
+#include "binary_trace.h"
 
 
+const size_t PARALLEL_MIN_EDGES = 100000;  // smaller graphs are peeled by a single thread
+const size_t SHARE_CHUNK = 1024;  // nodes handed from a busy peeling thread to an idle one at a time
+
+
+// Edges in trace order, converted to node ids and stored in peeling direction: src -> dst means
+// dst can't be peeled before src
+class EdgeList {
+public:
+    std::vector<int> src;
+    std::vector<int> dst;
+    std::vector<std::string> names;  // robot name, or "$" for resources
+};
+
+
+// Compressed adjacency of the whole trace. Each entry remembers the index of the edge that created
+// it, so any prefix of the trace can be checked without rebuilding the graph
 class Graph {
 public:
-    std::vector<std::vector<int>> adj_list;
-    std::vector<int> out_counts;
+    std::vector<int64_t> offsets;  // adj_list[offsets[n] .. offsets[n + 1]) are the successors of n
+    std::vector<int> adj_list;
+    std::vector<int> edge_ids;
+    std::unique_ptr<std::atomic<int>[]> out_counts;
     std::vector<std::string> names;
-} graph;
+    int num_nodes = 0;
+};
 
 
-std::vector<std::string> topological_sort(Graph &g) {
-    std::vector<std::string> deadlocked_robots;
-    std::vector<int> out = g.out_counts;
-    std::vector<int> zeros;
-
-    for (size_t i = 0; i < out.size(); i++)
-        if (out[i] == 0)
-            zeros.emplace_back(i);
-
-    while (!zeros.empty()) {
-        int n = zeros.back();
-        zeros.pop_back();
-        for (const int& n2 : g.adj_list[n]) {
-            out[n2]--;
-            if (out[n2] == 0)
-                zeros.emplace_back(n2);
-        }
+// Run f(begin, end, thread) over [0, n) split into one contiguous range per thread
+template <typename F>
+void parallel_for(int threads, size_t n, F f) {
+    if (threads <= 1) {
+        f(size_t(0), n, 0);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        size_t begin = n * t / threads;
+        size_t end = n * (t + 1) / threads;
+        workers.emplace_back([=, &f] { f(begin, end, t); });
     }
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+
+Graph build_graph(EdgeList &edges, int threads) {
+    Graph g;
+    g.num_nodes = edges.names.size();
+    g.names = std::move(edges.names);
+    g.out_counts.reset(new std::atomic<int>[g.num_nodes]);
+
+    // Counting sort by source: degrees, prefix sums, then scatter with per-node cursors
+    std::unique_ptr<std::atomic<int64_t>[]> cursor(new std::atomic<int64_t>[g.num_nodes + 1]);
+    parallel_for(threads, g.num_nodes + 1, [&](size_t begin, size_t end, int) {
+        for (size_t n = begin; n < end; n++)
+            cursor[n].store(0, std::memory_order_relaxed);
+    });
+    parallel_for(threads, edges.src.size(), [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++)
+            cursor[edges.src[i]].fetch_add(1, std::memory_order_relaxed);
+    });
+
+    g.offsets.resize(g.num_nodes + 1);
+    int64_t total = 0;
+    for (int n = 0; n <= g.num_nodes; n++) {
+        g.offsets[n] = total;
+        total += cursor[n].load(std::memory_order_relaxed);
+        cursor[n].store(g.offsets[n], std::memory_order_relaxed);
+    }
+
+    g.adj_list.resize(total);
+    g.edge_ids.resize(total);
+    parallel_for(threads, edges.src.size(), [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++) {
+            int64_t slot = cursor[edges.src[i]].fetch_add(1, std::memory_order_relaxed);
+            g.adj_list[slot] = edges.dst[i];
+            g.edge_ids[slot] = i;
+        }
+    });
+    return g;
+}
+
+
+// Kahn peel of the graph made of edges 0 .. last_edge. Threads start from the zero out-count nodes
+// of their own node range and decrement successors atomically; whoever brings a count to zero
+// peels that node next, so no rounds or barriers are needed. A thread with a long stack shares
+// chunks of it with idle threads. Robots that can't be peeled are deadlocked, returned in node order
+std::vector<std::string> topological_sort(Graph &g, int last_edge, int threads) {
+    std::atomic<int> *out = g.out_counts.get();
+
+    parallel_for(threads, g.num_nodes, [&](size_t begin, size_t end, int) {
+        for (size_t n = begin; n < end; n++)
+            out[n].store(0, std::memory_order_relaxed);
+    });
+    parallel_for(threads, g.adj_list.size(), [&](size_t begin, size_t end, int) {
+        for (size_t j = begin; j < end; j++)
+            if (g.edge_ids[j] <= last_edge)
+                out[g.adj_list[j]].fetch_add(1, std::memory_order_relaxed);
+    });
+
+    // Collect every initial zero before anyone peels, or a node could be both found here and
+    // brought to zero by another thread
+    std::vector<std::vector<int>> initial_zeros(threads);
+    parallel_for(threads, g.num_nodes, [&](size_t begin, size_t end, int t) {
+        for (size_t n = begin; n < end; n++)
+            if (out[n].load(std::memory_order_relaxed) == 0)
+                initial_zeros[t].emplace_back(n);
+    });
+
+    std::mutex shared_mutex;
+    std::vector<std::vector<int>> shared_chunks;
+    int busy = threads;
+
+    parallel_for(threads, g.num_nodes, [&](size_t, size_t, int t) {
+        std::vector<int> zeros = std::move(initial_zeros[t]);
+
+        while (true) {
+            while (!zeros.empty()) {
+                int n = zeros.back();
+                zeros.pop_back();
+                for (int64_t j = g.offsets[n]; j < g.offsets[n + 1]; j++) {
+                    if (g.edge_ids[j] > last_edge)
+                        continue;
+                    int n2 = g.adj_list[j];
+                    if (out[n2].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        zeros.emplace_back(n2);
+                }
+
+                if (threads > 1 && zeros.size() >= 2 * SHARE_CHUNK) {
+                    std::lock_guard<std::mutex> lock(shared_mutex);
+                    if (shared_chunks.size() < static_cast<size_t>(threads)) {
+                        shared_chunks.emplace_back(zeros.end() - SHARE_CHUNK, zeros.end());
+                        zeros.resize(zeros.size() - SHARE_CHUNK);
+                    }
+                }
+            }
+
+            // Out of work: take a shared chunk, or stop once every thread is idle and none is left
+            std::unique_lock<std::mutex> lock(shared_mutex);
+            busy--;
+            while (shared_chunks.empty() && busy > 0) {
+                lock.unlock();
+                std::this_thread::yield();
+                lock.lock();
+            }
+            if (shared_chunks.empty())
+                return;
+            zeros = std::move(shared_chunks.back());
+            shared_chunks.pop_back();
+            busy++;
+        }
+    });
 
     // Check for nodes that represent robots with non-zero out-degree, indicating a deadlock
-    for (size_t i = 0; i < out.size(); i++)
-        if (out[i] > 0 && g.names[i] != "$")
-            deadlocked_robots.emplace_back(g.names[i]);
+    std::vector<std::vector<std::string>> found(threads);
+    parallel_for(threads, g.num_nodes, [&](size_t begin, size_t end, int t) {
+        for (size_t n = begin; n < end; n++)
+            if (out[n].load(std::memory_order_relaxed) > 0 && g.names[n] != "$")
+                found[t].emplace_back(g.names[n]);
+    });
 
+    std::vector<std::string> deadlocked_robots;
+    for (std::vector<std::string> &part : found)
+        deadlocked_robots.insert(deadlocked_robots.end(), part.begin(), part.end());
     return deadlocked_robots;
 }
 
 
+// Find the first edge after which the graph has a cycle. Edges are only ever added, so a deadlock
+// in a prefix stays in every longer one: one full check of the whole trace, then a binary search
+// over prefixes, instead of a sort after every edge
+Result find_first_deadlock(EdgeList &edges) {
+    Result result;
+    result.edge_index = -1;
+    if (edges.src.empty())
+        return result;
+
+    int threads = 1;
+    if (edges.src.size() >= PARALLEL_MIN_EDGES)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    int last = edges.src.size() - 1;
+    Graph g = build_graph(edges, threads);
+    std::vector<std::string> deadlocked_robots = topological_sort(g, last, threads);
+    if (deadlocked_robots.empty())
+        return result;
+
+    int lo = 0, hi = last;  // the first deadlocked prefix ends in [lo, hi]
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        std::vector<std::string> robots = topological_sort(g, mid, threads);
+        if (robots.empty()) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+            deadlocked_robots = std::move(robots);
+        }
+    }
+
+    result.dl_procs = deadlocked_robots;
+    result.edge_index = lo;
+    return result;
+}
+
+
 // Main function to detect deadlock
 Result detect_deadlock(const std::vector<std::string> &edges) {
     Word2Int w2i;
-    Result result;
-    Graph g;
+    EdgeList list;
 
-    int max_size = (edges.size() * 2) + 1;  // max possible number of nodes
-
-    // Allocate enough memory for the graph
-    g.adj_list.resize(max_size);
-    g.out_counts.resize(max_size);
-    g.names.resize(max_size);
+    list.src.reserve(edges.size());
+    list.dst.reserve(edges.size());
+    list.names.reserve((edges.size() * 2) + 1);  // max possible number of nodes
 
     for (size_t i = 0; i < edges.size(); i++) {
         std::vector<std::string> e = split(edges[i]);
@@ -61,29 +239,107 @@ Result detect_deadlock(const std::vector<std::string> &edges) {
         // Convert node names to unique ints using Word2Int
         int robot = w2i.get(e[0]);
         int resource = w2i.get(e[2] + "$");
-        
+
         // Keep track of robot names
-        g.names[robot] = e[0];
-        g.names[resource] = "$";
+        int needed = std::max(robot, resource) + 1;
+        if (static_cast<int>(list.names.size()) < needed)
+            list.names.resize(needed);
+        list.names[robot] = e[0];
+        list.names[resource] = "$";
 
         // Check whether it's a request or assignment
         if (e[1] == "->") {
-            g.adj_list[resource].emplace_back(robot);
-            g.out_counts[robot]++;
+            list.src.emplace_back(resource);
+            list.dst.emplace_back(robot);
         } else {
-            g.adj_list[robot].emplace_back(resource);
-            g.out_counts[resource]++;
+            list.src.emplace_back(robot);
+            list.dst.emplace_back(resource);
         }
+    }
+
+    return find_first_deadlock(list);
+}
+
 
-        // Run topological sort and return if there is a deadlock
-        std::vector<std::string> deadlocked_robots = topological_sort(g);
-        if (!deadlocked_robots.empty()) {
-            result.dl_procs = deadlocked_robots;
-            result.edge_index = i;
-            return result;
+// Decode a mapped binary trace (see binary_trace.h) straight into the edge arrays. Nothing is
+// allocated per edge: the arrays are sized from the header and names are only built per node
+bool decode_binary_trace(const uint8_t *base, size_t size, EdgeList &list) {
+    BinaryTraceHeader header;
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, base, sizeof(header));
+    if (!valid_binary_trace_header(header, size) || header.num_names > INT32_MAX || header.num_records > INT32_MAX)
+        return false;
+
+    const uint8_t *end = base + size;
+    const uint8_t *p = base + header.names_offset;
+    list.names.resize(header.num_names);
+    for (std::string &name : list.names) {
+        uint64_t length;
+        if (!get_varint(p, end, length) || static_cast<uint64_t>(end - p) < (length >> 1))
+            return false;
+        if (length & 1)
+            name = "$";  // resources only need to be told apart from robots
+        else
+            name.assign(reinterpret_cast<const char*>(p), length >> 1);
+        p += length >> 1;
+    }
+
+    list.src.resize(header.num_records);
+    list.dst.resize(header.num_records);
+    p = base + header.records_offset;
+    int64_t robot = 0, resource = 0;
+    for (uint64_t i = 0; i < header.num_records; i++) {
+        uint64_t first, second;
+        if (!get_varint(p, end, first) || !get_varint(p, end, second))
+            return false;
+        robot += zigzag_decode(first >> 1);
+        resource += zigzag_decode(second);
+        if (robot < 0 || resource < 0 || static_cast<uint64_t>(std::max(robot, resource)) >= header.num_names)
+            return false;
+
+        // Same orientation as detect_deadlock: a request points from resource to robot
+        if (first & 1) {
+            list.src[i] = resource;
+            list.dst[i] = robot;
+        } else {
+            list.src[i] = robot;
+            list.dst[i] = resource;
         }
     }
+    return true;
+}
 
-    result.edge_index = -1;
-    return result;
+
+bool detect_deadlock_file(const char *path, Result &result) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);  // one front-to-back pass: read ahead, drop behind
+
+    EdgeList list;
+    bool valid = decode_binary_trace(static_cast<const uint8_t*>(data), st.st_size, list);
+    munmap(data, st.st_size);
+    if (!valid) {
+        std::cerr << path << ": not a valid binary trace\n";
+        return false;
+    }
+
+    result = find_first_deadlock(list);
+    return true;
 }
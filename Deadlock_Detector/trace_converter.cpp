@@ -0,0 +1,211 @@
+#include "binary_trace.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+// Converts deadlock detector traces between the text format ("R1 -> A" / "R1 <- A", one edge per
+// line) and the binary format of binary_trace.h:
+//
+//   trace_converter input.txt output.bin
+//   trace_converter --to-text input.bin output.txt
+
+const size_t OUTPUT_BUFFER_SIZE = 1 << 20;
+
+
+class BufferedWriter {
+public:
+    explicit BufferedWriter(FILE *file) : file(file) { buffer.reserve(OUTPUT_BUFFER_SIZE + 64); }
+    ~BufferedWriter() { flush(); }
+
+    void varint(uint64_t value) {
+        uint8_t bytes[10];
+        int n = put_varint(bytes, value);
+        buffer.insert(buffer.end(), bytes, bytes + n);
+        if (buffer.size() >= OUTPUT_BUFFER_SIZE)
+            flush();
+    }
+
+    void bytes(const char *data, size_t size) {
+        buffer.insert(buffer.end(), data, data + size);
+        if (buffer.size() >= OUTPUT_BUFFER_SIZE)
+            flush();
+    }
+
+    void flush() {
+        if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+            perror("write");
+        written += buffer.size();
+        buffer.clear();
+    }
+
+    uint64_t offset() const { return written + buffer.size(); }
+
+private:
+    FILE *file;
+    std::vector<uint8_t> buffer;
+    uint64_t written = 0;
+};
+
+
+// Split "robot arrow resource" without allocating; false if the line isn't an edge
+bool parse_edge(const std::string &line, std::string &robot, bool &request, std::string &resource) {
+    const char *whitespace = " \t\r";
+    size_t a = line.find_first_not_of(whitespace);
+    size_t b = line.find_first_of(whitespace, a);
+    size_t c = line.find_first_not_of(whitespace, b);
+    size_t d = line.find_first_of(whitespace, c);
+    size_t e = line.find_first_not_of(whitespace, d);
+    size_t f = line.find_first_of(whitespace, e);
+    if (e == std::string::npos)
+        return false;
+
+    robot.assign(line, a, b - a);
+    resource.assign(line, e, (f == std::string::npos ? line.size() : f) - e);
+    std::string arrow(line, c, d - c);
+    if (arrow != "->" && arrow != "<-")
+        return false;
+    request = (arrow == "->");
+    return true;
+}
+
+
+int text_to_binary(const char *input, const char *output) {
+    std::ifstream in(input);
+    FILE *out = fopen(output, "wb");
+    if (!in || !out) {
+        std::cerr << "Cannot open " << (in ? output : input) << std::endl;
+        return 1;
+    }
+
+    BinaryTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic));
+    fwrite(&header, sizeof(header), 1, out);  // rewritten once the counts are known
+
+    // Same numbering as Word2Int in detect_deadlock: resources get a "$" suffix as keys
+    std::unordered_map<std::string, int> ids;
+    std::vector<std::string> names;
+    std::vector<bool> is_resource;
+    auto node_id = [&](const std::string &key, const std::string &name, bool resource) {
+        auto it = ids.find(key);
+        if (it != ids.end())
+            return it->second;
+        int id = names.size();
+        ids.emplace(key, id);
+        names.emplace_back(name);
+        is_resource.push_back(resource);
+        return id;
+    };
+
+    BufferedWriter writer(out);
+    header.records_offset = sizeof(header);
+    std::string line, robot, resource;
+    bool request;
+    int64_t prev_robot = 0, prev_resource = 0;
+    uint64_t line_number = 0;
+
+    while (std::getline(in, line)) {
+        line_number++;
+        if (!parse_edge(line, robot, request, resource)) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos)
+                std::cerr << "Skipping line " << line_number << ": " << line << std::endl;
+            continue;
+        }
+
+        int64_t r = node_id(robot, robot, false);
+        int64_t s = node_id(resource + "$", resource, true);
+        writer.varint(zigzag_encode(r - prev_robot) << 1 | (request ? 1 : 0));
+        writer.varint(zigzag_encode(s - prev_resource));
+        prev_robot = r;
+        prev_resource = s;
+        header.num_records++;
+    }
+
+    header.names_offset = writer.offset() + sizeof(header);
+    for (size_t i = 0; i < names.size(); i++) {
+        writer.varint(static_cast<uint64_t>(names[i].size()) << 1 | (is_resource[i] ? 1 : 0));
+        writer.bytes(names[i].data(), names[i].size());
+    }
+    writer.flush();
+    header.num_names = names.size();
+    header.file_size = writer.offset() + sizeof(header);
+
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    fclose(out);
+
+    std::cerr << header.num_records << " edges, " << header.num_names << " nodes, " << header.file_size << " bytes\n";
+    return 0;
+}
+
+
+int binary_to_text(const char *input, const char *output) {
+    std::ifstream in(input, std::ios::binary);
+    std::ofstream out(output);
+    if (!in || !out) {
+        std::cerr << "Cannot open " << (in ? output : input) << std::endl;
+        return 1;
+    }
+
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    BinaryTraceHeader header;
+    if (data.size() < sizeof(header)) {
+        std::cerr << input << " is not a binary trace\n";
+        return 1;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (!valid_binary_trace_header(header, data.size())) {
+        std::cerr << input << " is not a binary trace or is corrupt\n";
+        return 1;
+    }
+
+    const uint8_t *base = reinterpret_cast<const uint8_t*>(data.data());
+    const uint8_t *end = base + data.size();
+    const uint8_t *p = base + header.names_offset;
+    std::vector<std::string> names(header.num_names);
+    for (std::string &name : names) {
+        uint64_t length;
+        if (!get_varint(p, end, length) || static_cast<uint64_t>(end - p) < (length >> 1)) {
+            std::cerr << "Corrupt dictionary\n";
+            return 1;
+        }
+        name.assign(reinterpret_cast<const char*>(p), length >> 1);
+        p += length >> 1;
+    }
+
+    p = base + header.records_offset;
+    int64_t robot = 0, resource = 0;
+    for (uint64_t i = 0; i < header.num_records; i++) {
+        uint64_t first, second;
+        if (!get_varint(p, end, first) || !get_varint(p, end, second)) {
+            std::cerr << "Corrupt record " << i << std::endl;
+            return 1;
+        }
+        robot += zigzag_decode(first >> 1);
+        resource += zigzag_decode(second);
+        if (robot < 0 || resource < 0 || static_cast<uint64_t>(std::max(robot, resource)) >= names.size()) {
+            std::cerr << "Record " << i << " refers to an unknown node\n";
+            return 1;
+        }
+        out << names[robot] << ((first & 1) ? " -> " : " <- ") << names[resource] << '\n';
+    }
+    return 0;
+}
+
+
+int main(int argc, char *argv[]) {
+    if (argc == 4 && strcmp(argv[1], "--to-text") == 0)
+        return binary_to_text(argv[2], argv[3]);
+    if (argc == 3)
+        return text_to_binary(argv[1], argv[2]);
+
+    std::cerr << "Usage: " << argv[0] << " input.txt output.bin\n"
+              << "       " << argv[0] << " --to-text input.bin output.txt\n";
+    return 1;
+}
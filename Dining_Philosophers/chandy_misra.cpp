@@ -0,0 +1,301 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// Chandy-Misra "dirty/clean fork" solution. Diners share no lock: each chopstick (fork) belongs
+// to exactly one of its two diners at a time, and forks and requests for them travel through
+// single-producer single-consumer mailboxes between neighbours. A hungry diner hands over a fork
+// only if it is dirty (already eaten with), which makes the protocol starvation free without
+// timeouts or the shouldYieldTurn heuristic. Astronomer types keep their meal lengths and pauses
+// from dining_philosophers.cpp, measured in configurable time units
+
+const int NUM_ASTRONOMERS = 10;
+const int NUM_ASYMMETRIC = 4;
+const int NUM_GREEDY = 3;
+const int AVG_EAT_TIME = 2;  // center of the normal distribution for eating times, in time units
+const int THINK_TIME = 2;  // pause after each meal, as in the threaded program
+const int RUN_TIME = 10;  // real seconds
+const int TIME_UNIT_US = 10000;  // length of one original second
+
+std::atomic<bool> stopFlag(false);  // flag for program termination
+
+enum class Message : uint8_t { REQUEST, FORK };
+enum class AstronomerType { ASYMMETRIC, SYMMETRIC, GREEDY };
+
+
+// One direction of an edge between neighbours. At most one request and one fork are ever in
+// flight per direction, so four slots are plenty
+struct alignas(64) Mailbox {
+    static const uint32_t CAPACITY = 4;
+
+    alignas(64) std::atomic<uint32_t> head{0};  // written by the receiver
+    alignas(64) std::atomic<uint32_t> tail{0};  // written by the sender
+    Message slots[CAPACITY];
+
+    void push(Message message) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        slots[t % CAPACITY] = message;
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    bool pop(Message &message) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        message = slots[h % CAPACITY];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// Futex word a diner sleeps on; bumped by neighbours after sending it a message
+struct alignas(64) Doorbell {
+    std::atomic<uint32_t> value{0};
+
+    void ring() {
+        value.fetch_add(1, std::memory_order_release);
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&value), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    // Sleep until rung (value != seen) or until timeoutUs elapses
+    void wait(uint32_t seen, long timeoutUs) {
+        struct timespec timeout = {timeoutUs / 1000000, (timeoutUs % 1000000) * 1000};
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&value), FUTEX_WAIT_PRIVATE, seen, &timeout, nullptr, 0);
+    }
+};
+
+// A diner's private view of one of its two forks
+struct ForkEnd {
+    bool hasFork;
+    bool dirty;
+    bool hasRequestToken;  // holding the token means the neighbour asked (or may ask) for the fork
+};
+
+
+const int LEFT = 0;
+const int RIGHT = 1;
+
+int numAstronomers = NUM_ASTRONOMERS;
+int timeUnitUs = TIME_UNIT_US;
+
+std::vector<std::unique_ptr<Mailbox[]>> inbox;  // inbox[i][side]: messages from the neighbour on that side
+std::vector<Doorbell> doorbells;
+std::vector<std::atomic<int>> eatCount;
+
+
+class Diner {
+public:
+    Diner(int id, AstronomerType type) : id(id), type(type), gen(std::random_device{}()) {
+        // Forks start with the lower numbered neighbour, dirty; the request token with the other.
+        // Chopstick i is left of astronomer i and right of astronomer i - 1
+        ends[LEFT] = (id == 0) ? ForkEnd{true, true, false} : ForkEnd{false, false, true};
+        ends[RIGHT] = (id == numAstronomers - 1) ? ForkEnd{false, false, true} : ForkEnd{true, true, false};
+    }
+
+    void run() {
+        while (!stopFlag) {
+            think();
+            if (!acquireForks())
+                break;
+            eat();
+        }
+    }
+
+private:
+    int neighbour(int side) const {
+        return side == LEFT ? (id - 1 + numAstronomers) % numAstronomers : (id + 1) % numAstronomers;
+    }
+
+    void send(int side, Message message) {
+        int other = neighbour(side);
+        inbox[other][1 - side].push(message);  // we are on the opposite side of our neighbour
+        doorbells[other].ring();
+    }
+
+    // Give a requested fork away if it is dirty and we aren't eating with it
+    void maybeYield(int side) {
+        ForkEnd &end = ends[side];
+        if (!eating && end.hasFork && end.dirty && end.hasRequestToken) {
+            end.hasFork = false;
+            end.dirty = false;  // forks are cleaned before being handed over
+            send(side, Message::FORK);
+        }
+    }
+
+    // Handle every pending message from both neighbours
+    void processMessages() {
+        Message message;
+        for (int side = LEFT; side <= RIGHT; side++) {
+            while (inbox[id][side].pop(message)) {
+                if (message == Message::FORK) {
+                    ends[side].hasFork = true;
+                    ends[side].dirty = false;
+                } else {
+                    ends[side].hasRequestToken = true;
+                }
+            }
+            maybeYield(side);
+        }
+    }
+
+    // Wait for messages for up to timeoutUs, answering requests while waiting
+    void waitForMessages(long timeoutUs) {
+        uint32_t seen = doorbells[id].value.load(std::memory_order_acquire);
+        processMessages();
+        doorbells[id].wait(seen, timeoutUs);
+        processMessages();
+    }
+
+    // Think (and keep serving neighbours) for a number of time units
+    void think() {
+        double units = THINK_TIME;
+        if (type == AstronomerType::ASYMMETRIC)
+            units += 1;  // asymmetric astronomers pause between their two chopsticks
+
+        auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<long>(units * timeUnitUs));
+        while (!stopFlag) {
+            long remaining = std::chrono::duration_cast<std::chrono::microseconds>(end - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0)
+                break;
+            waitForMessages(remaining);
+        }
+    }
+
+    // Request missing forks and wait until both are here. Returns false when stopping
+    bool acquireForks() {
+        while (!stopFlag) {
+            processMessages();
+            if (ends[LEFT].hasFork && ends[RIGHT].hasFork)
+                return true;
+
+            for (int side = LEFT; side <= RIGHT; side++) {
+                ForkEnd &end = ends[side];
+                if (!end.hasFork && end.hasRequestToken) {
+                    end.hasRequestToken = false;
+                    send(side, Message::REQUEST);
+                }
+            }
+            waitForMessages(timeUnitUs);
+        }
+        return false;
+    }
+
+    void eat() {
+        eating = true;
+
+        std::normal_distribution<> dis(AVG_EAT_TIME, 1.0);
+        int units = std::max(1, static_cast<int>(std::round(dis(gen))));
+        if (type == AstronomerType::GREEDY)
+            units *= 2;
+        std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long>(units) * timeUnitUs));
+
+        eatCount[id].fetch_add(type == AstronomerType::GREEDY ? 2 : 1, std::memory_order_relaxed);
+        eating = false;
+
+        // Both forks are dirty now; hand over any that were requested while we ate
+        ends[LEFT].dirty = ends[RIGHT].dirty = true;
+        processMessages();
+    }
+
+    int id;
+    AstronomerType type;
+    ForkEnd ends[2];
+    bool eating = false;
+    std::mt19937 gen;
+};
+
+
+std::vector<AstronomerType> placeAstronomers(int numAsymmetric, int numGreedy) {
+    // place astronomer types randomly
+    std::vector<AstronomerType> order(numAstronomers, AstronomerType::SYMMETRIC);
+    std::fill(order.begin(), order.begin() + numAsymmetric, AstronomerType::ASYMMETRIC);
+    std::fill(order.begin() + numAsymmetric, order.begin() + numAsymmetric + numGreedy, AstronomerType::GREEDY);
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::shuffle(order.begin(), order.end(), gen);
+    return order;
+}
+
+
+int main(int argc, char *argv[]) {
+    int numAsymmetric = NUM_ASYMMETRIC;
+    int numGreedy = NUM_GREEDY;
+    int runTime = RUN_TIME;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--astronomers") numAstronomers = value;
+        else if (option == "--asymmetric") numAsymmetric = value;
+        else if (option == "--greedy") numGreedy = value;
+        else if (option == "--seconds") runTime = value;
+        else if (option == "--time-unit-us") timeUnitUs = value;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (numAstronomers < 2 || numAsymmetric + numGreedy > numAstronomers) {
+        std::cerr << "Invalid astronomer mix\n";
+        return 1;
+    }
+
+    // Per-edge mailboxes, doorbells and counters
+    for (int i = 0; i < numAstronomers; i++)
+        inbox.emplace_back(new Mailbox[2]);
+    doorbells = std::vector<Doorbell>(numAstronomers);
+    eatCount = std::vector<std::atomic<int>>(numAstronomers);
+
+    std::vector<AstronomerType> types = placeAstronomers(numAsymmetric, numGreedy);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numAstronomers; i++)
+        threads.emplace_back([i, &types] { Diner(i, types[i]).run(); });
+
+    std::this_thread::sleep_for(std::chrono::seconds(runTime));
+    stopFlag = true;  // signal threads to stop
+    for (Doorbell &doorbell : doorbells)
+        doorbell.ring();
+    for (std::thread &thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Astronomer initials (A for asymmetric, S for symmetric, G for greedy) and eat counts
+    if (numAstronomers <= 50) {
+        std::cout << std::endl << "             ";
+        for (AstronomerType type : types)
+            std::cout << (type == AstronomerType::ASYMMETRIC ? 'A' : type == AstronomerType::SYMMETRIC ? 'S' : 'G') << ' ';
+        std::cout << std::endl << "Times eaten: ";
+        for (const std::atomic<int> &count : eatCount)
+            std::cout << count << ' ';
+        std::cout << std::endl;
+    }
+
+    long meals = 0;
+    int minCount = INT_MAX, maxCount = 0;
+    for (const std::atomic<int> &count : eatCount) {
+        meals += count;
+        minCount = std::min(minCount, count.load());
+        maxCount = std::max(maxCount, count.load());
+    }
+    std::cout << std::endl << numAstronomers << " astronomers, " << seconds << " seconds: " << meals << " meals ("
+              << meals / seconds << " meals/s) ; min/max per astronomer: "
+              << minCount << '/' << maxCount << "\n\n";
+}
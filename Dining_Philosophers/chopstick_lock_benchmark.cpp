@@ -0,0 +1,166 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <cstdlib>
+#include "chopstick_locks.h"
+#include "../Common/numa_lock.h"
+#include "../Common/perf_counters.h"
+
+
+// Compares chopstick locking schemes on the same table: the try_lock / try_lock_for polling with
+// fixed back-offs used by dining_philosophers.cpp against deadlock-free ordered acquisition with
+// std::timed_mutex, std::mutex, the FIFO TicketLock and the NUMA-aware CohortLock. Every diner
+// thinks and eats for a fixed (busy) time, so differences come from the locks alone. Results are
+// printed as CSV, with hardware counters for the whole run and per meal
+
+const int NUM_DINERS = 8;
+const int RUN_SECONDS = 2;
+const int EAT_US = 20;
+const int THINK_US = 20;
+const int UNIT_US = 100;  // stands in for one second of the original program's back-offs
+
+typedef std::chrono::steady_clock Clock;
+
+struct Config {
+    int diners = NUM_DINERS;
+    int seconds = RUN_SECONDS;
+    int eatUs = EAT_US;
+    int thinkUs = THINK_US;
+    int unitUs = UNIT_US;
+};
+
+std::atomic<bool> stopFlag(false);
+
+
+// Busy wait, sleeping would add the scheduler's wake-up latency to every meal
+void spinFor(int microseconds) {
+    auto end = Clock::now() + std::chrono::microseconds(microseconds);
+    while (Clock::now() < end)
+        cpuRelax();
+}
+
+
+// Scheme used by symAstronomer: grab what is free, wait a little for the other chopstick,
+// otherwise put everything down and back off for a fixed time
+void pollingDiner(int id, const Config &config, std::vector<std::timed_mutex> &chopsticks, long &meals) {
+    std::timed_mutex &left = chopsticks[id];
+    std::timed_mutex &right = chopsticks[(id + 1) % config.diners];
+    auto unit = std::chrono::microseconds(config.unitUs);
+
+    while (!stopFlag) {
+        bool rightAcquired = right.try_lock();
+        bool leftAcquired = left.try_lock();
+
+        if (!rightAcquired && !leftAcquired) {
+            std::this_thread::sleep_for(unit);
+            continue;
+        }
+
+        if (rightAcquired && !leftAcquired) {
+            leftAcquired = left.try_lock_for(unit / 2);
+            if (!leftAcquired)
+                right.unlock();
+        } else if (leftAcquired && !rightAcquired) {
+            rightAcquired = right.try_lock_for(unit / 2);
+            if (!rightAcquired)
+                left.unlock();
+        }
+
+        if (leftAcquired && rightAcquired) {
+            spinFor(config.eatUs);
+            meals++;
+            left.unlock();
+            right.unlock();
+            spinFor(config.thinkUs);
+        } else {
+            std::this_thread::sleep_for(2 * unit);
+        }
+    }
+}
+
+
+// Deadlock free by construction: both chopsticks are taken in global index order
+template <typename Lock>
+void orderedDiner(int id, const Config &config, std::vector<Lock> &chopsticks, long &meals) {
+    int leftIndex = id;
+    int rightIndex = (id + 1) % config.diners;
+
+    while (!stopFlag) {
+        lockInOrder(chopsticks[leftIndex], leftIndex, chopsticks[rightIndex], rightIndex);
+        spinFor(config.eatUs);
+        meals++;
+        chopsticks[leftIndex].unlock();
+        chopsticks[rightIndex].unlock();
+        spinFor(config.thinkUs);
+    }
+}
+
+
+// Run one scheme for config.seconds and print its CSV line
+template <typename Lock, typename DinerFn>
+void runScheme(const char *name, const Config &config, DinerFn diner) {
+    std::vector<Lock> chopsticks(config.diners);
+    std::vector<long> meals(config.diners, 0);
+    std::vector<std::thread> threads;
+
+    PerfCounters counters;
+    stopFlag = false;
+    counters.start();
+    auto start = Clock::now();
+    for (int i = 0; i < config.diners; i++)
+        threads.emplace_back([&, i] { diner(i, config, chopsticks, meals[i]); });
+
+    std::this_thread::sleep_for(std::chrono::seconds(config.seconds));
+    stopFlag = true;
+    for (std::thread &thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    PerfSample perf = counters.stop();
+
+    long total = 0;
+    for (long count : meals)
+        total += count;
+    auto minmax = std::minmax_element(meals.begin(), meals.end());
+    double mean = static_cast<double>(total) / config.diners;
+
+    std::cout << name << ',' << config.diners << ',' << total << ',' << total / seconds << ','
+              << *minmax.first << ',' << *minmax.second << ','
+              << (mean > 0 ? (*minmax.second - *minmax.first) / mean : 0.0) << perf.csv(total) << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+    Config config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--diners") config.diners = value;
+        else if (option == "--seconds") config.seconds = value;
+        else if (option == "--eat-us") config.eatUs = value;
+        else if (option == "--think-us") config.thinkUs = value;
+        else if (option == "--unit-us") config.unitUs = value;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.diners < 2 || config.seconds <= 0) {
+        std::cerr << "Need at least 2 diners and 1 second\n";
+        return 1;
+    }
+
+    // spread == (max - min) / mean meals per diner; lower is fairer
+    std::cout << "scheme,diners,meals,meals_per_s,min_meals,max_meals,spread" << perfCsvHeader() << '\n';
+    runScheme<std::timed_mutex>("timed_mutex_polling", config, pollingDiner);
+    runScheme<std::timed_mutex>("timed_mutex_ordered", config, orderedDiner<std::timed_mutex>);
+    runScheme<std::mutex>("std_mutex_ordered", config, orderedDiner<std::mutex>);
+    runScheme<TicketLock>("ticket_ordered", config, orderedDiner<TicketLock>);
+    runScheme<CohortLock>("cohort_ordered", config, orderedDiner<CohortLock>);
+}
@@ -0,0 +1,25 @@
+#ifndef CHOPSTICK_LOCKS_H
+#define CHOPSTICK_LOCKS_H
+
+#include "../Common/ticket_lock.h"
+
+
+// Lock types that can stand in for std::timed_mutex as a chopstick (TicketLock lives in
+// Common/ticket_lock.h). Any type providing lock/unlock/try_lock/try_lock_for works with
+// lockInOrder() and std::unique_lock
+
+
+// Acquire two chopsticks in global index order. Every diner agrees on the order, so no cycle of
+// waiters (and therefore no deadlock) can form, whatever the lock type
+template <typename Lock>
+void lockInOrder(Lock &first, int firstIndex, Lock &second, int secondIndex) {
+    if (secondIndex < firstIndex) {
+        second.lock();
+        first.lock();
+    } else {
+        first.lock();
+        second.lock();
+    }
+}
+
+#endif
@@ -0,0 +1,502 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <coroutine>
+#include <memory>
+#include <fstream>
+#include <cstdlib>
+#include <cmath>
+#include <unistd.h>
+
+
+// Dining philosophers with each astronomer as a C++20 coroutine instead of an OS thread.
+// A small pool of worker threads resumes whichever astronomers are ready; a chopstick that is
+// taken suspends the astronomer (about a kilobyte of frame and state) rather than blocking a
+// thread. The table is sized at runtime and time is scaled so one "second" of the original
+// program is TIME_UNIT_US microseconds
+
+const int NUM_ASTRONOMERS = 10000;
+const int NUM_ASYMMETRIC = 4000;
+const int NUM_GREEDY = 3000;
+const int NUM_WORKERS = 4;
+const int RUN_TIME = 5;  // real seconds
+const int TIME_UNIT_US = 1000;  // length of one original second
+const int AVG_EAT_TIME = 2;  // center of the normal distribution for eating times, in time units
+const int THRESHOLD = 3;  // max allowed difference in times eaten between astronomers sharing a chopstick
+
+typedef std::chrono::steady_clock Clock;
+
+std::atomic<bool> stopFlag(false);  // flag for program termination
+int timeUnitUs = TIME_UNIT_US;
+
+
+// Fire-and-forget coroutine: starts suspended (the scheduler resumes it) and frees its own frame
+struct DinerTask {
+    struct promise_type {
+        DinerTask get_return_object() { return DinerTask{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> handle;
+};
+
+
+class AsyncChopstick;
+
+// Per-astronomer wait record, lives as long as the table so timers can refer to it safely
+struct Diner {
+    enum class WaitState { NONE, WAITING, GRANTED, TIMED_OUT };
+
+    std::coroutine_handle<> handle;
+    std::atomic<AsyncChopstick*> waitingOn{nullptr};
+    std::atomic<uint64_t> waitSequence{0};  // identifies the current wait, stale timeouts are ignored
+    WaitState state = WaitState::NONE;
+    std::atomic<int> eatCount{0};
+};
+
+
+// Worker pool with a shared run queue and a timer heap for sleeps and lock timeouts
+class Scheduler {
+public:
+    void spawn(std::coroutine_handle<> handle) {
+        active++;
+        schedule(handle);
+    }
+
+    void schedule(std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            runQueue.emplace_back(handle);
+        }
+        cv.notify_one();
+    }
+
+    // Resume handle at deadline
+    void addSleep(Clock::time_point deadline, std::coroutine_handle<> handle) {
+        addTimer(Timer{deadline, handle, nullptr, 0});
+    }
+
+    // Fail diner's current lock wait at deadline unless it was granted first
+    void addTimeout(Clock::time_point deadline, Diner *diner, uint64_t sequence) {
+        addTimer(Timer{deadline, nullptr, diner, sequence});
+    }
+
+    void finished() {
+        if (--active == 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_all();
+        }
+    }
+
+    // Run workers until every coroutine has finished
+    void run(int numWorkers) {
+        std::vector<std::thread> workers;
+        for (int i = 0; i < numWorkers; i++)
+            workers.emplace_back([this] { workerLoop(); });
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+private:
+    struct Timer {
+        Clock::time_point deadline;
+        std::coroutine_handle<> handle;  // sleep
+        Diner *diner;  // lock timeout
+        uint64_t sequence;
+
+        bool operator>(const Timer &other) const { return deadline > other.deadline; }
+    };
+
+    void addTimer(const Timer &timer) {
+        bool earliest;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            earliest = timers.empty() || timer.deadline < timers.top().deadline;
+            timers.push(timer);
+        }
+        if (earliest)
+            cv.notify_one();
+    }
+
+    void workerLoop();
+    void expire(const Timer &timer);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::coroutine_handle<>> runQueue;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    std::atomic<int> active{0};
+};
+
+Scheduler scheduler;
+
+
+// Chopstick that suspends the calling coroutine instead of blocking its thread.
+// Waiters are served in FIFO order and ownership is handed over directly on unlock
+class AsyncChopstick {
+public:
+    bool try_lock() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (locked)
+            return false;
+        locked = true;
+        return true;
+    }
+
+    void unlock() {
+        std::coroutine_handle<> next;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (waiters.empty()) {
+                locked = false;
+                return;
+            }
+            Diner *diner = waiters.front();
+            waiters.pop_front();
+            diner->state = Diner::WaitState::GRANTED;
+            diner->waitingOn.store(nullptr, std::memory_order_relaxed);
+            next = diner->handle;
+        }
+        scheduler.schedule(next);
+    }
+
+    // co_await chopstick.lock_for(diner, timeout) -> true if the chopstick was acquired
+    struct LockAwaiter {
+        AsyncChopstick &chopstick;
+        Diner &diner;
+        Clock::duration timeout;
+        bool acquired = false;
+
+        bool await_ready() {
+            acquired = chopstick.try_lock();
+            return acquired;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            // Everything is registered under the chopstick's mutex; once it is released another
+            // worker may resume (and destroy) this frame, so only locals are used afterwards
+            AsyncChopstick &c = chopstick;
+            Diner &d = diner;
+            std::lock_guard<std::mutex> lock(c.mutex);
+            if (!c.locked) {
+                c.locked = true;
+                d.state = Diner::WaitState::GRANTED;
+                return false;
+            }
+
+            d.handle = handle;
+            d.state = Diner::WaitState::WAITING;
+            uint64_t sequence = d.waitSequence.fetch_add(1, std::memory_order_relaxed) + 1;
+            d.waitingOn.store(&c, std::memory_order_relaxed);
+            c.waiters.emplace_back(&d);
+            scheduler.addTimeout(Clock::now() + timeout, &d, sequence);
+            return true;
+        }
+
+        bool await_resume() {
+            return acquired || diner.state == Diner::WaitState::GRANTED;
+        }
+    };
+
+    LockAwaiter lock_for(Diner &diner, Clock::duration timeout) {
+        return LockAwaiter{*this, diner, timeout};
+    }
+
+    // Called by the scheduler when a wait times out. Only a diner still queued here can be
+    // cancelled; once granted it may already be waiting somewhere else
+    std::coroutine_handle<> cancel(Diner *diner, uint64_t sequence) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find(waiters.begin(), waiters.end(), diner);
+        if (it == waiters.end() || diner->waitSequence.load(std::memory_order_relaxed) != sequence)
+            return nullptr;
+
+        waiters.erase(it);
+        diner->state = Diner::WaitState::TIMED_OUT;
+        diner->waitingOn.store(nullptr, std::memory_order_relaxed);
+        return diner->handle;
+    }
+
+private:
+    std::mutex mutex;
+    bool locked = false;
+    std::deque<Diner*> waiters;
+};
+
+
+void Scheduler::expire(const Timer &timer) {
+    if (timer.handle) {
+        timer.handle.resume();
+        return;
+    }
+
+    AsyncChopstick *chopstick = timer.diner->waitingOn.load(std::memory_order_relaxed);
+    if (chopstick == nullptr)
+        return;
+    std::coroutine_handle<> handle = chopstick->cancel(timer.diner, timer.sequence);
+    if (handle)
+        handle.resume();
+}
+
+void Scheduler::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (active > 0) {
+        if (!runQueue.empty()) {
+            std::coroutine_handle<> handle = runQueue.front();
+            runQueue.pop_front();
+            lock.unlock();
+            handle.resume();
+            lock.lock();
+            continue;
+        }
+
+        if (!timers.empty() && timers.top().deadline <= Clock::now()) {
+            Timer timer = timers.top();
+            timers.pop();
+            lock.unlock();
+            expire(timer);
+            lock.lock();
+            continue;
+        }
+
+        if (timers.empty())
+            cv.wait(lock);
+        else
+            cv.wait_until(lock, timers.top().deadline);
+    }
+    cv.notify_all();
+}
+
+
+// co_await sleepFor(units): suspend for a number of (scaled) seconds
+struct SleepAwaiter {
+    Clock::duration duration;
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { scheduler.addSleep(Clock::now() + duration, handle); }
+    void await_resume() {}
+};
+
+SleepAwaiter sleepFor(double units) {
+    return SleepAwaiter{std::chrono::microseconds(static_cast<int64_t>(units * timeUnitUs))};
+}
+
+std::chrono::microseconds units(double value) {
+    return std::chrono::microseconds(static_cast<int64_t>(value * timeUnitUs));
+}
+
+
+// Table
+// ================================================================================
+
+std::vector<std::unique_ptr<AsyncChopstick>> chopsticks;
+std::vector<std::unique_ptr<Diner>> diners;
+
+
+int generate_random_eating_time() {
+    // thread-local random number generator
+    static thread_local std::mt19937 gen(std::random_device{}());
+
+    // Normal distribution centered on AVG_EAT_TIME with standard deviation of 1
+    std::normal_distribution<> dis(AVG_EAT_TIME, 1.0);
+    return std::max(1, static_cast<int>(std::round(dis(gen))));
+}
+
+bool shouldYieldTurn(int astronomerId) {
+    int n = static_cast<int>(diners.size());
+    int left = (astronomerId - 1 + n) % n;
+    int right = (astronomerId + 1) % n;
+
+    int mine = diners[astronomerId]->eatCount.load(std::memory_order_relaxed);
+    return (mine - diners[left]->eatCount.load(std::memory_order_relaxed) >= THRESHOLD) ||
+           (mine - diners[right]->eatCount.load(std::memory_order_relaxed) >= THRESHOLD);
+}
+
+
+DinerTask symAstronomer(int astronomerId) {
+    Diner &me = *diners[astronomerId];
+    AsyncChopstick &left = *chopsticks[astronomerId];
+    AsyncChopstick &right = *chopsticks[(astronomerId + 1) % chopsticks.size()];
+
+    while (!stopFlag) {
+        // Attempt to acquire both chopsticks without waiting
+        bool rightAcquired = right.try_lock();
+        bool leftAcquired = left.try_lock();
+
+        if (!rightAcquired && !leftAcquired) {
+            co_await sleepFor(1);
+            continue;
+        }
+
+        // If only one chopstick is acquired, try to get the other within 0.5 units
+        if (rightAcquired && !leftAcquired) {
+            leftAcquired = co_await left.lock_for(me, units(0.5));
+            if (!leftAcquired)
+                right.unlock();
+        } else if (leftAcquired && !rightAcquired) {
+            rightAcquired = co_await right.lock_for(me, units(0.5));
+            if (!rightAcquired)
+                left.unlock();
+        }
+
+        if (leftAcquired && rightAcquired) {
+            if (!shouldYieldTurn(astronomerId)) {
+                co_await sleepFor(generate_random_eating_time());
+                me.eatCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            left.unlock();
+            right.unlock();
+        }
+
+        co_await sleepFor(2);
+    }
+    scheduler.finished();
+}
+
+
+DinerTask asymAstronomer(int astronomerId) {
+    Diner &me = *diners[astronomerId];
+    AsyncChopstick &left = *chopsticks[astronomerId];
+    AsyncChopstick &right = *chopsticks[(astronomerId + 1) % chopsticks.size()];
+
+    while (!stopFlag) {
+        if (right.try_lock()) {
+            co_await sleepFor(1);
+
+            if (co_await left.lock_for(me, units(2))) {
+                if (!shouldYieldTurn(astronomerId)) {
+                    co_await sleepFor(generate_random_eating_time());
+                    me.eatCount.fetch_add(1, std::memory_order_relaxed);
+                }
+                left.unlock();
+            }
+            right.unlock();
+        }
+
+        co_await sleepFor(2);
+    }
+    scheduler.finished();
+}
+
+
+DinerTask greedyAstronomer(int astronomerId) {
+    Diner &me = *diners[astronomerId];
+    AsyncChopstick &left = *chopsticks[astronomerId];
+    AsyncChopstick &right = *chopsticks[(astronomerId + 1) % chopsticks.size()];
+
+    while (!stopFlag) {
+        if (co_await left.lock_for(me, units(2))) {
+            if (co_await right.lock_for(me, units(2))) {
+                // Greedy astronomers eat twice as long and it counts as two meals
+                if (!shouldYieldTurn(astronomerId)) {
+                    co_await sleepFor(2 * generate_random_eating_time());
+                    me.eatCount.fetch_add(2, std::memory_order_relaxed);
+                }
+                right.unlock();
+            }
+            left.unlock();
+        }
+
+        co_await sleepFor(2);
+    }
+    scheduler.finished();
+}
+
+
+std::vector<int> placeAstronomers(int numAstronomers, int numAsymmetric, int numGreedy) {
+    // place astronomer types randomly
+    // asymmetric == 0, symmetric == 1, greedy == 2
+    std::vector<int> order(numAstronomers, 1);
+    std::fill(order.begin(), order.begin() + numAsymmetric, 0);
+    std::fill(order.begin() + numAsymmetric, order.begin() + numAsymmetric + numGreedy, 2);
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::shuffle(order.begin(), order.end(), gen);
+    return order;
+}
+
+long residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+
+int main(int argc, char *argv[]) {
+    int numAstronomers = NUM_ASTRONOMERS;
+    int numAsymmetric = NUM_ASYMMETRIC;
+    int numGreedy = NUM_GREEDY;
+    int numWorkers = NUM_WORKERS;
+    int runTime = RUN_TIME;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--astronomers") numAstronomers = value;
+        else if (option == "--asymmetric") numAsymmetric = value;
+        else if (option == "--greedy") numGreedy = value;
+        else if (option == "--workers") numWorkers = value;
+        else if (option == "--seconds") runTime = value;
+        else if (option == "--time-unit-us") timeUnitUs = value;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (numAstronomers < 2 || numAsymmetric + numGreedy > numAstronomers || numWorkers <= 0) {
+        std::cerr << "Invalid table configuration\n";
+        return 1;
+    }
+
+    long memoryBefore = residentBytes();
+
+    // Table and astronomer coroutines
+    std::vector<int> astronomers = placeAstronomers(numAstronomers, numAsymmetric, numGreedy);
+    for (int i = 0; i < numAstronomers; i++) {
+        chopsticks.emplace_back(new AsyncChopstick());
+        diners.emplace_back(new Diner());
+    }
+    for (int i = 0; i < numAstronomers; i++) {
+        DinerTask task = (astronomers[i] == 0) ? asymAstronomer(i)
+                       : (astronomers[i] == 1) ? symAstronomer(i) : greedyAstronomer(i);
+        scheduler.spawn(task.handle);
+    }
+
+    long memoryPerDiner = (residentBytes() - memoryBefore) / numAstronomers;
+
+    // Stop the table after runTime seconds; the astronomers finish their current attempt
+    std::thread timer([runTime] {
+        std::this_thread::sleep_for(std::chrono::seconds(runTime));
+        stopFlag = true;
+    });
+
+    auto start = Clock::now();
+    scheduler.run(numWorkers);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    timer.join();
+
+    long meals = 0;
+    int minCount = diners[0]->eatCount, maxCount = diners[0]->eatCount;
+    for (const std::unique_ptr<Diner> &diner : diners) {
+        meals += diner->eatCount;
+        minCount = std::min(minCount, diner->eatCount.load());
+        maxCount = std::max(maxCount, diner->eatCount.load());
+    }
+
+    std::cout << numAstronomers << " astronomers on " << numWorkers << " worker threads for " << seconds << " s\n";
+    std::cout << "Meals: " << meals << " (" << meals / seconds << " meals/s) ; min/max per astronomer: "
+              << minCount << '/' << maxCount << std::endl;
+    std::cout << "Memory per astronomer (chopstick, state and coroutine frame): ~" << memoryPerDiner << " bytes\n";
+}
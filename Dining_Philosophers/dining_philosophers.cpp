@@ -1,10 +1,13 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <vector>
 #include <chrono>
 #include <random>
 #include <algorithm>
+#include "../Common/lock_profiler.h"
+#include "../Common/trace.h"
 
 
 const int NUM_ASTRONOMERS = 10;
@@ -13,20 +16,122 @@ const int NUM_GREEDY = 3;
 const int AVG_EAT_TIME = 2;  // center of the normal distribution for eating times
 const int MAX_WAIT_TIME = 2;
 
-bool stopFlag = false;  // flag for program termination
-
-std::vector<std::timed_mutex> chopstickMutexes(NUM_ASTRONOMERS);  // mutexes for each chopstick
-std::vector<int> eatCount(NUM_ASTRONOMERS, 0);  // tracks no. of times each astronomer has eaten
-std::mutex eatCountMutex;  // mutex to protect access to eatCount
+std::atomic<bool> stopFlag(false);  // flag for program termination
+
+// Chopstick lock type: std::timed_mutex by default, FIFO ticket lock with -DTICKET_CHOPSTICKS,
+// NUMA-aware cohort lock with -DNUMA_CHOPSTICKS. -DLOCK_PROFILING wraps any of them to report
+// per-chopstick contention at exit. With a queueing lock (BLOCKING_CHOPSTICKS) every astronomer
+// waits in line for both chopsticks instead of polling with try_lock and backing off
+#ifdef TICKET_CHOPSTICKS
+#include "chopstick_locks.h"
+typedef ProfiledMutex<TicketLock> ChopstickMutex;
+#define BLOCKING_CHOPSTICKS
+#elif defined(NUMA_CHOPSTICKS)
+#include "chopstick_locks.h"
+#include "../Common/numa_lock.h"
+typedef ProfiledMutex<CohortLock> ChopstickMutex;
+#define BLOCKING_CHOPSTICKS  // try_lock only succeeds on an empty queue, so hand-offs need lock()
+#else
+typedef ProfiledMutex<std::timed_mutex> ChopstickMutex;
+#endif
+
+std::vector<ChopstickMutex> chopstickMutexes(NUM_ASTRONOMERS);  // mutexes for each chopstick
 
 // Enums for possible states
 enum class AstronomerState { CONTEMPLATING, CONSUMING };
 enum class ChopstickState { AVAILABLE, IN_USE };
 
-// Vectors to track states
-std::vector<AstronomerState> astronomerStates(NUM_ASTRONOMERS, AstronomerState::CONTEMPLATING);
-std::vector<ChopstickState> chopstickStates(NUM_ASTRONOMERS, ChopstickState::AVAILABLE);
-std::mutex stateMutex;  // mutex for state updates
+// Each slot is written by one thread at a time (the astronomer itself, or whoever holds the
+// chopstick's mutex) and is padded to its own cache line, so updates never contend with other
+// diners. sequence is a seqlock counter: odd while an update is in progress
+struct alignas(64) AstronomerSlot {
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<AstronomerState> state{AstronomerState::CONTEMPLATING};
+    std::atomic<int> eatCount{0};  // no. of times the astronomer has eaten
+};
+
+struct alignas(64) ChopstickSlot {
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<ChopstickState> state{ChopstickState::AVAILABLE};
+};
+
+std::vector<AstronomerSlot> astronomerSlots(NUM_ASTRONOMERS);
+std::vector<ChopstickSlot> chopstickSlots(NUM_ASTRONOMERS);
+
+
+// Seqlock write: make the sequence odd, apply the update, make it even again
+template <typename Slot, typename Update>
+void seqlockWrite(Slot &slot, Update update) {
+    uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    update(slot);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void setChopstickState(int chopstick, ChopstickState state) {
+    seqlockWrite(chopstickSlots[chopstick], [state](ChopstickSlot &slot) {
+        slot.state.store(state, std::memory_order_relaxed);
+    });
+}
+
+void setAstronomerState(int astronomerId, AstronomerState state) {
+    seqlockWrite(astronomerSlots[astronomerId], [state](AstronomerSlot &slot) {
+        slot.state.store(state, std::memory_order_relaxed);
+    });
+}
+
+void addMeals(int astronomerId, int meals) {
+    seqlockWrite(astronomerSlots[astronomerId], [meals](AstronomerSlot &slot) {
+        slot.eatCount.store(slot.eatCount.load(std::memory_order_relaxed) + meals, std::memory_order_relaxed);
+    });
+}
+
+
+// Consistent view of the whole table for the visualizer
+struct TableSnapshot {
+    std::vector<AstronomerState> astronomerStates;
+    std::vector<ChopstickState> chopstickStates;
+    std::vector<int> eatCount;
+};
+
+// Epoch snapshot: collect every slot, then check that no sequence changed in the meantime.
+// Readers retry instead of blocking, so diners never wait for the visualizer
+TableSnapshot takeSnapshot() {
+    TableSnapshot snapshot;
+    snapshot.astronomerStates.resize(NUM_ASTRONOMERS);
+    snapshot.chopstickStates.resize(NUM_ASTRONOMERS);
+    snapshot.eatCount.resize(NUM_ASTRONOMERS);
+    std::vector<uint32_t> sequences(2 * NUM_ASTRONOMERS);
+
+    const int MAX_ATTEMPTS = 100;  // after that, settle for a view that is consistent per slot
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+        bool stable = true;
+
+        for (int i = 0; i < NUM_ASTRONOMERS; i++) {
+            sequences[i] = astronomerSlots[i].sequence.load(std::memory_order_acquire);
+            sequences[NUM_ASTRONOMERS + i] = chopstickSlots[i].sequence.load(std::memory_order_acquire);
+            if ((sequences[i] | sequences[NUM_ASTRONOMERS + i]) & 1)
+                stable = false;  // update in progress
+
+            snapshot.astronomerStates[i] = astronomerSlots[i].state.load(std::memory_order_relaxed);
+            snapshot.eatCount[i] = astronomerSlots[i].eatCount.load(std::memory_order_relaxed);
+            snapshot.chopstickStates[i] = chopstickSlots[i].state.load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        for (int i = 0; i < NUM_ASTRONOMERS && stable; i++) {
+            if (astronomerSlots[i].sequence.load(std::memory_order_relaxed) != sequences[i] ||
+                chopstickSlots[i].sequence.load(std::memory_order_relaxed) != sequences[NUM_ASTRONOMERS + i])
+                stable = false;
+        }
+
+        if (stable)
+            break;
+        std::this_thread::yield();
+    }
+    return snapshot;
+}
 
 
 int generate_random_eating_time() {
@@ -45,8 +150,6 @@ int generate_random_eating_time() {
 bool shouldYieldTurn(int astronomerId) {
     // Evaluated before allowing an astronomer to eat to prevent starvation
 
-    std::lock_guard<std::mutex> lock(eatCountMutex);
-
     // IDs of left and right astronomers
     int left = (astronomerId - 1 + NUM_ASTRONOMERS) % NUM_ASTRONOMERS;
     int right = (astronomerId + 1) % NUM_ASTRONOMERS;
@@ -55,7 +158,10 @@ bool shouldYieldTurn(int astronomerId) {
     // between a greedy astronomer and its neighbours is THRESHOLD + 1
 
     const int THRESHOLD = 3;  // max allowed difference in times eaten between astronomers sharing a chopstick
-    if ((eatCount[astronomerId] - eatCount[left] >= THRESHOLD) || (eatCount[astronomerId] - eatCount[right] >= THRESHOLD))
+    int mine = astronomerSlots[astronomerId].eatCount.load(std::memory_order_relaxed);
+    int leftCount = astronomerSlots[left].eatCount.load(std::memory_order_relaxed);
+    int rightCount = astronomerSlots[right].eatCount.load(std::memory_order_relaxed);
+    if ((mine - leftCount >= THRESHOLD) || (mine - rightCount >= THRESHOLD))
         return true;
     return false;
 }
@@ -67,66 +173,52 @@ void eat(int astronomerId, bool greedy) {
     int right = (astronomerId + 1) % NUM_ASTRONOMERS;
 
     // Chopsticks being used
-    {
-        std::lock_guard<std::mutex> stateLock(stateMutex);
-        chopstickStates[left] = ChopstickState::IN_USE;
-        chopstickStates[right] = ChopstickState::IN_USE;
-    }
+    setChopstickState(left, ChopstickState::IN_USE);
+    setChopstickState(right, ChopstickState::IN_USE);
 
     // Check if astronomer should yield his turn
     if (shouldYieldTurn(astronomerId)) {
+        TRACE_INSTANT("yield turn", astronomerId);
         // Chopsticks now available
-        std::lock_guard<std::mutex> stateLock(stateMutex);
-        chopstickStates[left] = ChopstickState::AVAILABLE;
-        chopstickStates[right] = ChopstickState::AVAILABLE;
+        setChopstickState(left, ChopstickState::AVAILABLE);
+        setChopstickState(right, ChopstickState::AVAILABLE);
         return;
     }
 
     // Astronomer consuming
-    {
-        std::lock_guard<std::mutex> stateLock(stateMutex);
-        astronomerStates[astronomerId] = AstronomerState::CONSUMING;
-    }
+    setAstronomerState(astronomerId, AstronomerState::CONSUMING);
 
     // Eating
     int eatingTime = generate_random_eating_time();
     if (greedy)
         eatingTime *= 2;
 
+    TRACE_BEGIN("eat");
     std::this_thread::sleep_for(std::chrono::seconds(eatingTime));
+    TRACE_END("eat");
 
     // Astronomer contemplating
-    {
-        std::lock_guard<std::mutex> stateLock(stateMutex);
-        astronomerStates[astronomerId] = AstronomerState::CONTEMPLATING;
-    }
+    setAstronomerState(astronomerId, AstronomerState::CONTEMPLATING);
 
     // Chopsticks now available
-    {
-        std::lock_guard<std::mutex> stateLock(stateMutex);
-        chopstickStates[left] = ChopstickState::AVAILABLE;
-        chopstickStates[right] = ChopstickState::AVAILABLE;
-    }
+    setChopstickState(left, ChopstickState::AVAILABLE);
+    setChopstickState(right, ChopstickState::AVAILABLE);
 
     // Update eat count
-    {
-        std::lock_guard<std::mutex> lock(eatCountMutex);
-        if (greedy)
-            eatCount[astronomerId]++;
-        eatCount[astronomerId]++;
-    }
+    addMeals(astronomerId, greedy ? 2 : 1);
 }
 
 
 void symAstronomer(int astronomerId) {
+    TRACE_THREAD_NAME("astronomer", astronomerId);
     while (!stopFlag) {
         // IDs of left and right chopsticks
         int left = astronomerId;
         int right = (astronomerId + 1) % NUM_ASTRONOMERS;
 
         // Construct locks but don't attempt to acquire them
-        std::unique_lock<std::timed_mutex> leftLock(chopstickMutexes[left], std::defer_lock);
-        std::unique_lock<std::timed_mutex> rightLock(chopstickMutexes[right], std::defer_lock);
+        std::unique_lock<ChopstickMutex> leftLock(chopstickMutexes[left], std::defer_lock);
+        std::unique_lock<ChopstickMutex> rightLock(chopstickMutexes[right], std::defer_lock);
 
         // Attempt to acquire both chopsticks without waiting
         bool rightAcquired = rightLock.try_lock();
@@ -142,35 +234,21 @@ void symAstronomer(int astronomerId) {
         std::chrono::milliseconds timeout(500);
         if (rightAcquired && !leftAcquired) {
             // Update right chopstick state
-            {
-                std::lock_guard<std::mutex> stateLock(stateMutex);
-                chopstickStates[right] = ChopstickState::IN_USE;
-            }
+            setChopstickState(right, ChopstickState::IN_USE);
 
             if (!leftLock.try_lock_for(timeout)) {
+                // Update right chopstick state while still holding it, then release it
+                setChopstickState(right, ChopstickState::AVAILABLE);
                 rightLock.unlock();  // if left one wasn't acquired in time
-
-                // Update right chopstick state
-                {
-                    std::lock_guard<std::mutex> stateLock(stateMutex);
-                    chopstickStates[right] = ChopstickState::AVAILABLE;
-                }
             }
         } else if (leftAcquired && !rightAcquired) {
             // Update left chopstick state
-            {
-                std::lock_guard<std::mutex> stateLock(stateMutex);
-                chopstickStates[left] = ChopstickState::IN_USE;
-            }
+            setChopstickState(left, ChopstickState::IN_USE);
 
             if (!rightLock.try_lock_for(timeout)) {
+                // Update left chopstick state while still holding it, then release it
+                setChopstickState(left, ChopstickState::AVAILABLE);
                 leftLock.unlock();  // if right one wasn't acquired in time
-
-                // Update left chopstick state
-                {
-                    std::lock_guard<std::mutex> stateLock(stateMutex);
-                    chopstickStates[left] = ChopstickState::AVAILABLE;
-                }
             }
         }
 
@@ -182,29 +260,30 @@ void symAstronomer(int astronomerId) {
         }
 
         // Allow other astronomers to grab chopsticks before attempting to eat again
+        TRACE_BEGIN("think");
         std::this_thread::sleep_for(std::chrono::seconds(2));
+        TRACE_END("think");
     }
 }
 
 
 void asymAstronomer(int astronomerId) {
+    TRACE_THREAD_NAME("astronomer", astronomerId);
     while (!stopFlag) {
         // IDs of left and right chopsticks
         int left = astronomerId;
         int right = (astronomerId + 1) % NUM_ASTRONOMERS;
 
-        std::unique_lock<std::timed_mutex> rightLock(chopstickMutexes[right], std::defer_lock);
+        std::unique_lock<ChopstickMutex> rightLock(chopstickMutexes[right], std::defer_lock);
 
         // Attempt to acquire the right chopstick
         if (rightLock.try_lock()) {
             // Update right chopstick state as it will be locked before eating due to delay
-            std::unique_lock<std::mutex> stateLock(stateMutex);
-            chopstickStates[right] = ChopstickState::IN_USE;
-            stateLock.unlock();
+            setChopstickState(right, ChopstickState::IN_USE);
 
             std::this_thread::sleep_for(std::chrono::seconds(1));  // wait for at least 1 second
 
-            std::unique_lock<std::timed_mutex> leftLock(chopstickMutexes[left], std::defer_lock);
+            std::unique_lock<ChopstickMutex> leftLock(chopstickMutexes[left], std::defer_lock);
             // Attempt to acquire left chopstick within 2 seconds
             if (leftLock.try_lock_for(std::chrono::seconds(2))) {
                 eat(astronomerId, false);
@@ -215,20 +294,23 @@ void asymAstronomer(int astronomerId) {
         }
 
         // Allow other astronomers to grab the chopsticks before attempting to eat again
+        TRACE_BEGIN("think");
         std::this_thread::sleep_for(std::chrono::seconds(2));
+        TRACE_END("think");
     }
 }
 
 
 void greedyAstronomer(int astronomerId) {
+    TRACE_THREAD_NAME("astronomer", astronomerId);
     while (!stopFlag) {
         // IDs of left and right chopsticks
         int left = astronomerId;
         int right = (astronomerId + 1) % NUM_ASTRONOMERS;
 
         // Construct locks but don't attempt to acquire them
-        std::unique_lock<std::timed_mutex> leftLock(chopstickMutexes[left], std::defer_lock);
-        std::unique_lock<std::timed_mutex> rightLock(chopstickMutexes[right], std::defer_lock);
+        std::unique_lock<ChopstickMutex> leftLock(chopstickMutexes[left], std::defer_lock);
+        std::unique_lock<ChopstickMutex> rightLock(chopstickMutexes[right], std::defer_lock);
 
         // Attempt to acquire each lock for secs
         std::chrono::seconds timeout(2);
@@ -249,9 +331,37 @@ void greedyAstronomer(int astronomerId) {
             rightLock.unlock();
 
         // Allow other astronomers to grab the chopsticks before attempting to eat again
+        TRACE_BEGIN("think");
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        TRACE_END("think");
+    }
+}
+
+
+#ifdef BLOCKING_CHOPSTICKS
+// Any astronomer type when the chopsticks queue their waiters: take both in global index order
+// (no deadlock) and block until they are free. The FIFO queues decide who eats next, so the
+// try_lock attempts and the back-off sleeps between them go away; greedy astronomers still eat
+// twice as long
+void orderedAstronomer(int astronomerId, bool greedy) {
+    TRACE_THREAD_NAME("astronomer", astronomerId);
+    while (!stopFlag) {
+        // IDs of left and right chopsticks
+        int left = astronomerId;
+        int right = (astronomerId + 1) % NUM_ASTRONOMERS;
+
+        lockInOrder(chopstickMutexes[left], left, chopstickMutexes[right], right);
+        eat(astronomerId, greedy);
+        chopstickMutexes[left].unlock();
+        chopstickMutexes[right].unlock();
+
+        // Contemplate before getting back in line
+        TRACE_BEGIN("think");
         std::this_thread::sleep_for(std::chrono::seconds(2));
+        TRACE_END("think");
     }
 }
+#endif
 
 
 std::vector<int> placeAstronomers(){
@@ -280,8 +390,7 @@ std::vector<int> placeAstronomers(){
 void outputInfo(std::vector<char> astrInitials) {
     // Visualize astronomer and chopstick states periodically
     while (!stopFlag) {
-        std::unique_lock<std::mutex> stateLock(stateMutex);
-        std::unique_lock<std::mutex> eatLock(eatCountMutex);
+        TableSnapshot snapshot = takeSnapshot();  // never blocks the astronomers
 
         // Astronomer initials (A for asymmetric, S for symmetric, G for greedy)
         std::cout << std::endl << std::endl << "             ";
@@ -290,21 +399,19 @@ void outputInfo(std::vector<char> astrInitials) {
 
         // Eating count of each astronomer
         std::cout << std::endl << "Times eaten: ";
-        for (int count : eatCount)
+        for (int count : snapshot.eatCount)
             std::cout << count << ' ';
         std::cout << std::endl << std::endl;
 
         // Astronomer and chopstick states
         for (int i = 0; i < NUM_ASTRONOMERS; i++) {
             std::cout << "    Chopstick " << i << " is " <<
-                (chopstickStates[i] == ChopstickState::AVAILABLE ? "AVAILABLE" : "IN USE") << '\n';
+                (snapshot.chopstickStates[i] == ChopstickState::AVAILABLE ? "AVAILABLE" : "IN USE") << '\n';
             std::cout << "(" << astrInitials[i] << ") Astronomer " << i << " is " <<
-                (astronomerStates[i] == AstronomerState::CONTEMPLATING ? "CONTEMPLATING" : "CONSUMING") << '\n';
+                (snapshot.astronomerStates[i] == AstronomerState::CONTEMPLATING ? "CONTEMPLATING" : "CONSUMING") << '\n';
         }
         std::cout << std::endl;
 
-        stateLock.unlock();
-        eatLock.unlock();
         std::this_thread::sleep_for(std::chrono::seconds(1)); // update interval
     }
 }
@@ -316,16 +423,32 @@ int main() {
     std::vector<std::thread> threads;
     std::vector<char> astrInitials;
 
+    for (int i = 0; i < NUM_ASTRONOMERS; i++)
+        nameLock(chopstickMutexes[i], "chopstick", i);
+    TRACE_START("dining_philosophers.trace.json");  // timeline of the run with -DEVENT_TRACING
+
     // Initialize astronomer threads
     for (int i = 0; i < NUM_ASTRONOMERS; i++) {
         if (astronomers[i] == 0) {
+#ifdef BLOCKING_CHOPSTICKS
+            threads.emplace_back(orderedAstronomer, i, false);
+#else
             threads.emplace_back(asymAstronomer, i);  // initialize asymAstronomer
+#endif
             astrInitials.emplace_back('A');
         } else if (astronomers[i] == 1) {
+#ifdef BLOCKING_CHOPSTICKS
+            threads.emplace_back(orderedAstronomer, i, false);
+#else
             threads.emplace_back(symAstronomer, i);  // initialize symAstronomer
+#endif
             astrInitials.emplace_back('S');
         } else {
+#ifdef BLOCKING_CHOPSTICKS
+            threads.emplace_back(orderedAstronomer, i, true);
+#else
             threads.emplace_back(greedyAstronomer, i);  // initialize greedyAstronomer
+#endif
             astrInitials.emplace_back('G');
         }
     }
@@ -339,6 +462,13 @@ int main() {
     for (int i = 0; i < NUM_ASTRONOMERS; i++)
         threads[i].join();
     visualizeStates.join();
+    TRACE_STOP();
+
+    // Total meals, read without stopping anyone
+    int meals = 0;
+    for (int count : takeSnapshot().eatCount)
+        meals += count;
 
-    std::cout << "\n45 seconds have passed, exiting program\n\n";
+    std::cout << "\n45 seconds have passed, exiting program (" << meals << " meals, "
+              << meals / 45.0 << " meals per second)\n\n";
 }
@@ -0,0 +1,407 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <functional>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+
+
+// Discrete-event version of dining_philosophers.cpp. The astronomers behave exactly like the
+// threaded ones (same try_lock / try_lock_for timeouts, back-offs and yield policy) but time is
+// virtual: instead of sleeping, each astronomer schedules its next step in a priority queue and
+// the simulation jumps straight to the earliest pending event
+
+const int NUM_ASTRONOMERS = 10;
+const int NUM_ASYMMETRIC = 4;
+const int NUM_GREEDY = 3;
+const int AVG_EAT_TIME = 2;  // center of the normal distribution for eating times
+const int THRESHOLD = 3;  // max allowed difference in times eaten between astronomers sharing a chopstick
+const int RUN_TIME = 45;  // simulated seconds
+
+typedef int64_t VirtualTime;  // microseconds of simulated time
+const VirtualTime SECOND = 1000000;
+const VirtualTime MILLISECOND = 1000;
+
+
+// Tunable parameters, defaults match the threaded program
+struct Config {
+    int numAstronomers = NUM_ASTRONOMERS;
+    int numAsymmetric = NUM_ASYMMETRIC;
+    int numGreedy = NUM_GREEDY;
+    int threshold = THRESHOLD;
+    VirtualTime runTime = RUN_TIME * SECOND;
+    VirtualTime symTimeout = 500 * MILLISECOND;  // symAstronomer: wait for the second chopstick
+    VirtualTime asymTimeout = 2 * SECOND;  // asymAstronomer: wait for the left chopstick
+    VirtualTime greedyTimeout = 2 * SECOND;  // greedyAstronomer: wait for each chopstick
+    VirtualTime symRetry = 1 * SECOND;  // symAstronomer: back-off when no chopstick was free
+    VirtualTime backOff = 2 * SECOND;  // everyone: pause after an attempt
+    VirtualTime asymDelay = 1 * SECOND;  // asymAstronomer: pause between right and left chopstick
+    unsigned seed = 0;
+};
+
+
+// Steps of the astronomer state machines
+enum class Phase {
+    SYM_START, SYM_SECOND,
+    ASYM_START, ASYM_AFTER_DELAY, ASYM_LEFT,
+    GREEDY_START, GREEDY_LEFT, GREEDY_RIGHT,
+    EAT_DONE, FINISH, START
+};
+
+enum class AstronomerType { ASYMMETRIC, SYMMETRIC, GREEDY };
+
+struct Astronomer {
+    AstronomerType type;
+    Phase phase;
+    bool holdsLeft = false;
+    bool holdsRight = false;
+    bool granted = false;  // result of the last timed wait
+    bool greedyMeal = false;
+    uint64_t token = 0;  // bumped whenever a pending event must be ignored (e.g. timeout after a grant)
+};
+
+// Simulated std::timed_mutex: owner plus the astronomers blocked in try_lock_for
+struct Chopstick {
+    int owner = -1;
+    std::deque<int> waiters;
+};
+
+struct Event {
+    VirtualTime time;
+    uint64_t sequence;  // keeps events at the same instant in FIFO order
+    int astronomer;
+    uint64_t token;
+
+    bool operator>(const Event &other) const {
+        return time != other.time ? time > other.time : sequence > other.sequence;
+    }
+};
+
+
+class Table {
+public:
+    Table(const Config &config, const std::vector<AstronomerType> &types)
+        : config(config), astronomers(types.size()), chopsticks(types.size()), eatCount(types.size(), 0),
+          waitingOn(types.size(), -1), gen(config.seed) {
+        for (size_t i = 0; i < types.size(); i++) {
+            astronomers[i].type = types[i];
+            astronomers[i].phase = Phase::START;
+            schedule(static_cast<int>(i), 0);
+        }
+    }
+
+    // Process events until the simulated run time is over
+    void run() {
+        while (!events.empty() && events.top().time < config.runTime) {
+            Event event = events.top();
+            events.pop();
+            processed++;
+
+            if (event.token != astronomers[event.astronomer].token)
+                continue;  // stale timeout
+            now = event.time;
+            step(event.astronomer);
+        }
+    }
+
+    const std::vector<int> &counts() const { return eatCount; }
+    uint64_t eventsProcessed() const { return processed; }
+
+private:
+    int leftOf(int id) const { return id; }
+    int rightOf(int id) const { return (id + 1) % static_cast<int>(astronomers.size()); }
+
+    void schedule(int id, VirtualTime delay) {
+        events.push(Event{now + delay, nextSequence++, id, astronomers[id].token});
+    }
+
+    // Sleep for delay, then continue with next
+    void sleepThen(int id, VirtualTime delay, Phase next) {
+        astronomers[id].phase = next;
+        schedule(id, delay);
+    }
+
+    bool tryLock(int id, int chopstick) {
+        if (chopsticks[chopstick].owner != -1)
+            return false;
+        chopsticks[chopstick].owner = id;
+        return true;
+    }
+
+    // try_lock_for: returns true if the chopstick was free, otherwise queues the astronomer and
+    // resumes it at next either when it is handed the chopstick or when the timeout expires
+    bool tryLockFor(int id, int chopstick, VirtualTime timeout, Phase next) {
+        Astronomer &a = astronomers[id];
+        a.phase = next;
+        if (tryLock(id, chopstick)) {
+            a.granted = true;
+            return true;
+        }
+
+        a.granted = false;
+        chopsticks[chopstick].waiters.emplace_back(id);
+        waitingOn[id] = chopstick;
+        schedule(id, timeout);
+        return false;
+    }
+
+    void unlock(int chopstick) {
+        Chopstick &c = chopsticks[chopstick];
+        c.owner = -1;
+
+        // Hand the chopstick to the first astronomer still waiting for it
+        if (!c.waiters.empty()) {
+            int id = c.waiters.front();
+            c.waiters.pop_front();
+            waitingOn[id] = -1;
+
+            Astronomer &a = astronomers[id];
+            c.owner = id;
+            a.granted = true;
+            a.token++;  // cancel its timeout
+            schedule(id, 0);
+        }
+    }
+
+    // A resumed astronomer whose timeout fired has to leave the chopstick's wait queue
+    void cancelWait(int id) {
+        if (waitingOn[id] == -1)
+            return;
+        std::deque<int> &waiters = chopsticks[waitingOn[id]].waiters;
+        waiters.erase(std::find(waiters.begin(), waiters.end(), id));
+        waitingOn[id] = -1;
+    }
+
+    void releaseAll(int id) {
+        Astronomer &a = astronomers[id];
+        if (a.holdsLeft)
+            unlock(leftOf(id));
+        if (a.holdsRight)
+            unlock(rightOf(id));
+        a.holdsLeft = a.holdsRight = false;
+    }
+
+    bool shouldYieldTurn(int id) const {
+        int n = static_cast<int>(astronomers.size());
+        int left = (id - 1 + n) % n;
+        int right = (id + 1) % n;
+        return (eatCount[id] - eatCount[left] >= config.threshold) || (eatCount[id] - eatCount[right] >= config.threshold);
+    }
+
+    VirtualTime randomEatingTime() {
+        std::normal_distribution<> dis(AVG_EAT_TIME, 1.0);
+        return std::max(1, static_cast<int>(std::round(dis(gen)))) * SECOND;
+    }
+
+    // Start eating (both chopsticks held); returns false if the astronomer yields its turn
+    bool eat(int id, bool greedy) {
+        if (shouldYieldTurn(id))
+            return false;
+
+        VirtualTime eatingTime = randomEatingTime();
+        if (greedy)
+            eatingTime *= 2;
+        astronomers[id].greedyMeal = greedy;
+        sleepThen(id, eatingTime, Phase::EAT_DONE);
+        return true;
+    }
+
+    // Run the astronomer's state machine until it blocks on a timer or a chopstick
+    void step(int id) {
+        Astronomer &a = astronomers[id];
+        int left = leftOf(id);
+        int right = rightOf(id);
+
+        cancelWait(id);
+
+        while (true) {
+            switch (a.phase) {
+                case Phase::START:
+                    a.phase = (a.type == AstronomerType::SYMMETRIC) ? Phase::SYM_START
+                            : (a.type == AstronomerType::ASYMMETRIC) ? Phase::ASYM_START : Phase::GREEDY_START;
+                    break;
+
+                // symAstronomer
+                case Phase::SYM_START:
+                    a.holdsRight = tryLock(id, right);
+                    a.holdsLeft = tryLock(id, left);
+                    if (!a.holdsLeft && !a.holdsRight) {
+                        sleepThen(id, config.symRetry, Phase::START);
+                        return;
+                    }
+                    if (a.holdsLeft && a.holdsRight) {
+                        a.granted = true;
+                        a.phase = Phase::SYM_SECOND;
+                        break;
+                    }
+                    if (!tryLockFor(id, a.holdsLeft ? right : left, config.symTimeout, Phase::SYM_SECOND))
+                        return;
+                    break;
+
+                case Phase::SYM_SECOND:
+                    if (a.granted) {
+                        a.holdsLeft = a.holdsRight = true;
+                        if (eat(id, false))
+                            return;
+                    }
+                    a.phase = Phase::FINISH;
+                    break;
+
+                // asymAstronomer
+                case Phase::ASYM_START:
+                    if (!tryLock(id, right)) {
+                        sleepThen(id, config.backOff, Phase::START);
+                        return;
+                    }
+                    a.holdsRight = true;
+                    sleepThen(id, config.asymDelay, Phase::ASYM_AFTER_DELAY);
+                    return;
+
+                case Phase::ASYM_AFTER_DELAY:
+                    if (!tryLockFor(id, left, config.asymTimeout, Phase::ASYM_LEFT))
+                        return;
+                    break;
+
+                case Phase::ASYM_LEFT:
+                    if (a.granted) {
+                        a.holdsLeft = true;
+                        if (eat(id, false))
+                            return;
+                    }
+                    a.phase = Phase::FINISH;
+                    break;
+
+                // greedyAstronomer
+                case Phase::GREEDY_START:
+                    if (!tryLockFor(id, left, config.greedyTimeout, Phase::GREEDY_LEFT))
+                        return;
+                    break;
+
+                case Phase::GREEDY_LEFT:
+                    if (!a.granted) {
+                        a.phase = Phase::FINISH;
+                        break;
+                    }
+                    a.holdsLeft = true;
+                    if (!tryLockFor(id, right, config.greedyTimeout, Phase::GREEDY_RIGHT))
+                        return;
+                    break;
+
+                case Phase::GREEDY_RIGHT:
+                    if (a.granted) {
+                        a.holdsRight = true;
+                        if (eat(id, true))
+                            return;
+                    }
+                    a.phase = Phase::FINISH;
+                    break;
+
+                // Shared tail: count the meal, put the chopsticks down and back off
+                case Phase::EAT_DONE:
+                    if (a.greedyMeal)
+                        eatCount[id]++;
+                    eatCount[id]++;
+                    a.phase = Phase::FINISH;
+                    break;
+
+                case Phase::FINISH:
+                    releaseAll(id);
+                    sleepThen(id, config.backOff, Phase::START);
+                    return;
+            }
+        }
+    }
+
+    Config config;
+    std::vector<Astronomer> astronomers;
+    std::vector<Chopstick> chopsticks;
+    std::vector<int> eatCount;
+    std::vector<int> waitingOn;  // chopstick each astronomer is blocked on, -1 if none
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    std::mt19937 gen;
+    VirtualTime now = 0;
+    uint64_t nextSequence = 0;
+    uint64_t processed = 0;
+};
+
+
+std::vector<AstronomerType> placeAstronomers(const Config &config) {
+    // place astronomer types randomly
+    std::vector<AstronomerType> order;
+    for (int i = 0; i < config.numAsymmetric; i++)
+        order.emplace_back(AstronomerType::ASYMMETRIC);
+
+    for (int i = 0; i < config.numGreedy; i++)
+        order.emplace_back(AstronomerType::GREEDY);
+
+    int numSym = config.numAstronomers - config.numAsymmetric - config.numGreedy;
+    for (int i = 0; i < numSym; i++)
+        order.emplace_back(AstronomerType::SYMMETRIC);
+
+    std::mt19937 gen(config.seed);
+    std::shuffle(order.begin(), order.end(), gen);
+    return order;
+}
+
+
+int main(int argc, char *argv[]) {
+    Config config;
+    config.seed = std::random_device{}();
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        long value = atol(argv[i + 1]);
+        if (option == "--astronomers") config.numAstronomers = static_cast<int>(value);
+        else if (option == "--asymmetric") config.numAsymmetric = static_cast<int>(value);
+        else if (option == "--greedy") config.numGreedy = static_cast<int>(value);
+        else if (option == "--threshold") config.threshold = static_cast<int>(value);
+        else if (option == "--seconds") config.runTime = value * SECOND;
+        else if (option == "--sym-timeout-ms") config.symTimeout = value * MILLISECOND;
+        else if (option == "--asym-timeout-ms") config.asymTimeout = value * MILLISECOND;
+        else if (option == "--greedy-timeout-ms") config.greedyTimeout = value * MILLISECOND;
+        else if (option == "--seed") config.seed = static_cast<unsigned>(value);
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.numAstronomers < 2 || config.numAsymmetric + config.numGreedy > config.numAstronomers) {
+        std::cerr << "Invalid astronomer mix\n";
+        return 1;
+    }
+
+    std::vector<AstronomerType> types = placeAstronomers(config);
+    Table table(config, types);
+
+    auto start = std::chrono::steady_clock::now();
+    table.run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Astronomer initials (A for asymmetric, S for symmetric, G for greedy) and eat counts
+    const std::vector<int> &counts = table.counts();
+    long meals = 0;
+    if (config.numAstronomers <= 50) {
+        std::cout << "             ";
+        for (AstronomerType type : types)
+            std::cout << (type == AstronomerType::ASYMMETRIC ? 'A' : type == AstronomerType::SYMMETRIC ? 'S' : 'G') << ' ';
+        std::cout << std::endl << "Times eaten: ";
+        for (int count : counts)
+            std::cout << count << ' ';
+        std::cout << std::endl << std::endl;
+    }
+    for (int count : counts)
+        meals += count;
+
+    auto minmax = std::minmax_element(counts.begin(), counts.end());
+    std::cout << "Simulated " << config.runTime / SECOND << " s in " << seconds << " s of real time\n";
+    std::cout << "Meals: " << meals << " ; min/max per astronomer: " << *minmax.first << '/' << *minmax.second << std::endl;
+    std::cout << "Events: " << table.eventsProcessed() << " (" << table.eventsProcessed() / seconds << " events/s, "
+              << meals / seconds << " meals/s)\n";
+}
@@ -0,0 +1,321 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// Called with the ready descriptor and the poll events (EPOLLIN/POLLIN, EPOLLHUP/POLLHUP, ...)
+typedef std::function<void(int fd, uint32_t events)> EventHandler;
+
+
+// Readiness based event loop for many IPC channels (pipes, eventfds, sockets, ...).
+// The epoll backend is always available; the io_uring backend batches every registration made
+// between two runOnce() calls into a single io_uring_enter and reaps completions in bulk
+class EventLoop {
+public:
+    enum Backend { EPOLL, IO_URING };
+
+    EventLoop() {}
+    ~EventLoop() { shutdown(); }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop &operator=(const EventLoop&) = delete;
+
+    // Falls back to epoll if io_uring is requested but not available. Returns false on failure
+    bool init(Backend requested, unsigned queueDepth = 256) {
+        shutdown();
+        if (requested == IO_URING && setupUring(queueDepth)) {
+            active = IO_URING;
+            return true;
+        }
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd == -1)
+            return false;
+        active = EPOLL;
+        return true;
+    }
+
+    Backend backend() const { return active; }
+
+    // Watch fd for readability (hang-ups are always reported). The io_uring backend may report
+    // a descriptor only once per wake-up, so handlers should read everything that is available
+    bool add(int fd, EventHandler handler) {
+        handlers[fd] = std::move(handler);
+
+        if (active == EPOLL) {
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+        }
+
+        armPoll(fd);
+        return true;
+    }
+
+    // Stop watching fd; the caller still owns (and closes) the descriptor
+    void remove(int fd) {
+        if (handlers.erase(fd) == 0)
+            return;
+
+        if (active == EPOLL) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            return;
+        }
+
+        struct io_uring_sqe *sqe = nextSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = static_cast<uint64_t>(fd);
+        sqe->user_data = REMOVE_TAG;
+    }
+
+    size_t size() const { return handlers.size(); }
+
+    // Wait up to timeoutMs (forever if negative) and dispatch every ready event.
+    // Returns the number of handlers called, or -1 on error
+    int runOnce(int timeoutMs) {
+        return active == EPOLL ? runEpoll(timeoutMs) : runUring(timeoutMs);
+    }
+
+private:
+    static const uint64_t TIMEOUT_TAG = UINT64_MAX;
+    static const uint64_t REMOVE_TAG = UINT64_MAX - 1;
+    static const int MAX_EVENTS = 256;
+
+    int runEpoll(int timeoutMs) {
+        struct epoll_event events[MAX_EVENTS];
+        int ready = epoll_wait(epollFd, events, MAX_EVENTS, timeoutMs);
+        if (ready == -1)
+            return errno == EINTR ? 0 : -1;
+
+        int dispatched = 0;
+        for (int i = 0; i < ready; i++) {
+            auto it = handlers.find(events[i].data.fd);
+            if (it == handlers.end())
+                continue;  // removed by an earlier handler in this batch
+            EventHandler handler = it->second;
+            handler(events[i].data.fd, events[i].events);
+            dispatched++;
+        }
+        return dispatched;
+    }
+
+    int runUring(int timeoutMs) {
+        // A timeout is just another request that completes after timeoutMs
+        if (timeoutMs >= 0 && !timeoutPending) {
+            timeout.tv_sec = timeoutMs / 1000;
+            timeout.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+            struct io_uring_sqe *sqe = nextSqe();
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uint64_t>(&timeout);
+            sqe->len = 1;
+            sqe->user_data = TIMEOUT_TAG;
+            timeoutPending = true;
+        }
+
+        // Submit everything queued since the last call and wait for at least one completion
+        unsigned wait = (timeoutMs == 0) ? 0 : 1;
+        if (enter(unsubmitted, wait) == -1 && errno != EINTR && errno != ETIME)
+            return -1;
+
+        // Reap the whole completion batch before running handlers, they may queue new requests
+        std::vector<struct io_uring_cqe> completions;
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+            completions.push_back(cqes[head & *cqMask]);
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+        int dispatched = 0;
+        for (const struct io_uring_cqe &cqe : completions) {
+            if (cqe.user_data == TIMEOUT_TAG) {
+                timeoutPending = false;
+                continue;
+            }
+            if (cqe.user_data == REMOVE_TAG)
+                continue;
+
+            int fd = static_cast<int>(cqe.user_data);
+            auto it = handlers.find(fd);
+            if (it == handlers.end() || cqe.res == -ECANCELED)
+                continue;
+
+            // The poll itself failed (e.g. -EBADF): re-arming would only fail again. Drop the
+            // descriptor and report it to its handler once, as epoll reports EPOLLERR
+            if (cqe.res < 0) {
+                EventHandler handler = it->second;
+                remove(fd);
+                handler(fd, POLLERR);
+                dispatched++;
+                continue;
+            }
+
+            // Single-shot polls (or multishot polls the kernel ended) have to be re-armed
+            if (!(cqe.flags & IORING_CQE_F_MORE))
+                armPoll(fd);
+
+            EventHandler handler = it->second;
+            handler(fd, static_cast<uint32_t>(cqe.res));
+            dispatched++;
+        }
+        return dispatched;
+    }
+
+    bool setupUring(unsigned entries) {
+#ifdef __NR_io_uring_setup
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ringFd == -1)
+            return false;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap)
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            sqRing = nullptr;
+            shutdown();
+            return false;
+        }
+        cqRing = sqRing;
+        if (!singleMmap) {
+            cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) {
+                cqRing = nullptr;
+                shutdown();
+                return false;
+            }
+        }
+
+        sqEntries = params.sq_entries;
+        sqes = static_cast<struct io_uring_sqe*>(mmap(nullptr, sqEntries * sizeof(struct io_uring_sqe),
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            sqes = nullptr;
+            shutdown();
+            return false;
+        }
+
+        char *sq = static_cast<char*>(sqRing);
+        char *cq = static_cast<char*>(cqRing);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+#else
+        (void)entries;
+        return false;
+#endif
+    }
+
+    // Queue a (multishot where supported) poll request for fd
+    void armPoll(int fd) {
+        struct io_uring_sqe *sqe = nextSqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = POLLIN;
+#ifdef IORING_POLL_ADD_MULTI
+        sqe->len = IORING_POLL_ADD_MULTI;
+#endif
+        sqe->user_data = static_cast<uint64_t>(fd);
+    }
+
+    // Next free submission entry; submits the current batch first if the queue is full
+    struct io_uring_sqe *nextSqe() {
+        unsigned tail = *sqTail;
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == sqEntries) {
+            enter(unsubmitted, 0);
+            tail = *sqTail;
+        }
+
+        unsigned index = tail & *sqMask;
+        struct io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        unsubmitted++;
+        return sqe;
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete) {
+        int rc = static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete,
+            minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+        if (rc >= 0)
+            unsubmitted -= std::min(unsubmitted, static_cast<unsigned>(rc));
+        return rc;
+    }
+
+    void shutdown() {
+        if (sqes != nullptr)
+            munmap(sqes, sqEntries * sizeof(struct io_uring_sqe));
+        if (cqRing != nullptr && !singleMmap)
+            munmap(cqRing, cqRingSize);
+        if (sqRing != nullptr)
+            munmap(sqRing, sqRingSize);
+        if (ringFd != -1)
+            close(ringFd);
+        if (epollFd != -1)
+            close(epollFd);
+
+        sqes = nullptr;
+        sqRing = cqRing = nullptr;
+        ringFd = epollFd = -1;
+        unsubmitted = 0;
+        timeoutPending = false;
+        handlers.clear();
+    }
+
+    Backend active = EPOLL;
+    std::unordered_map<int, EventHandler> handlers;
+
+    // epoll backend
+    int epollFd = -1;
+
+    // io_uring backend
+    int ringFd = -1;
+    void *sqRing = nullptr;
+    void *cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    bool singleMmap = false;
+    unsigned sqEntries = 0;
+    struct io_uring_sqe *sqes = nullptr;
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    struct io_uring_cqe *cqes = nullptr;
+    unsigned unsubmitted = 0;
+    bool timeoutPending = false;
+    struct __kernel_timespec timeout;
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "event_loop.h"
+#include "shm_region.h"
+
+
+const int NUM_CHILDREN = 200;  // default number of workers, can be overridden by argv[1]
+const int NUM_MESSAGES = 50;  // messages sent to each worker
+const size_t MESSAGE_SIZE = 64;  // fixed size messages, smaller than PIPE_BUF so writes are atomic
+
+
+// Convert string to uppercase
+void to_uppercase(char *str) {
+    while (*str) {
+        *str = toupper((unsigned char)*str);
+        str++;
+    }
+}
+
+
+// Parent side of one worker. Requests always go through a pipe; even workers reply through a
+// second pipe, odd workers write the reply into a shared memory slot and ring an eventfd doorbell
+struct Channel {
+    pid_t pid;
+    int requestFd;  // write end of the parent -> child pipe
+    int replyFd;  // read end of the child -> parent pipe, or the doorbell eventfd
+    bool doorbell;
+    bool open;  // still watched by the event loop
+    int sent;
+    int received;
+};
+
+
+// Child: answer requests until the parent closes the request pipe
+void runChild(int requestFd, int replyFd, bool doorbell, char *slot) {
+    char buffer[MESSAGE_SIZE];
+    while (read(requestFd, buffer, MESSAGE_SIZE) == static_cast<ssize_t>(MESSAGE_SIZE)) {
+        buffer[MESSAGE_SIZE - 1] = '\0';
+        to_uppercase(buffer);
+
+        if (doorbell) {
+            memcpy(slot, buffer, MESSAGE_SIZE);
+            uint64_t one = 1;
+            write(replyFd, &one, sizeof(one));  // ring the doorbell
+        } else {
+            write(replyFd, buffer, MESSAGE_SIZE);
+        }
+    }
+    _exit(0);
+}
+
+
+void sendRequest(Channel &channel, int index) {
+    char buffer[MESSAGE_SIZE] = {0};
+    snprintf(buffer, sizeof(buffer), "message %d for child %d", channel.sent, index);
+    write(channel.requestFd, buffer, MESSAGE_SIZE);
+    channel.sent++;
+}
+
+
+int main(int argc, char *argv[]) {
+    int numChildren = (argc > 1) ? atoi(argv[1]) : NUM_CHILDREN;
+    bool useUring = (argc > 2) && strcmp(argv[2], "--io-uring") == 0;
+
+    if (numChildren <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [num_children] [--io-uring]\n";
+        return 1;
+    }
+
+    // Every worker needs two descriptors in the parent
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    // A request written to a dead worker must fail with EPIPE rather than kill the parent
+    signal(SIGPIPE, SIG_IGN);
+
+    // One reply slot per worker for the doorbell channels
+    SharedRegion region;
+    if (!region.create(static_cast<size_t>(numChildren) * MESSAGE_SIZE)) {
+        perror("shared region error");
+        return 1;
+    }
+    char *slots = static_cast<char*>(region.data());
+
+    EventLoop loop;
+    if (!loop.init(useUring ? EventLoop::IO_URING : EventLoop::EPOLL)) {
+        perror("event loop error");
+        return 1;
+    }
+    std::cout << "Using " << (loop.backend() == EventLoop::IO_URING ? "io_uring" : "epoll") << " backend\n";
+
+    // Fork workers
+    std::vector<Channel> channels(numChildren);
+    for (int i = 0; i < numChildren; i++) {
+        Channel &channel = channels[i];
+        channel.doorbell = (i % 2 == 1);
+        channel.sent = channel.received = 0;
+        channel.open = true;
+
+        int requestPipe[2];
+        int replyPipe[2] = {-1, -1};
+        if (pipe(requestPipe) == -1) {
+            perror("pipe error");
+            return 1;
+        }
+        if (channel.doorbell) {
+            replyPipe[0] = replyPipe[1] = eventfd(0, EFD_CLOEXEC);
+            if (replyPipe[0] == -1) {
+                perror("eventfd error");
+                return 1;
+            }
+        } else if (pipe(replyPipe) == -1) {
+            perror("pipe error");
+            return 1;
+        }
+
+        channel.pid = fork();
+        if (channel.pid < 0) {
+            perror("fork error");
+            return 1;
+        }
+
+        if (channel.pid == 0) {  // child
+            close(requestPipe[1]);  // close unused write end
+            if (!channel.doorbell)
+                close(replyPipe[0]);  // close unused read end
+
+            // Drop the descriptors inherited from earlier siblings so their pipes see EOF
+            for (int j = 0; j < i; j++) {
+                close(channels[j].requestFd);
+                close(channels[j].replyFd);
+            }
+            runChild(requestPipe[0], replyPipe[1], channel.doorbell, slots + i * MESSAGE_SIZE);
+        }
+
+        close(requestPipe[0]);  // close unused read end
+        if (!channel.doorbell)
+            close(replyPipe[1]);  // close unused write end
+        channel.requestFd = requestPipe[1];
+        channel.replyFd = replyPipe[0];
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int finished = 0;
+    int failed = 0;
+
+    // Stop serving a channel; closing the request pipe tells the worker to exit
+    auto closeChannel = [&](int i) {
+        Channel &channel = channels[i];
+        loop.remove(channel.replyFd);
+        close(channel.requestFd);
+        close(channel.replyFd);
+        channel.open = false;
+        finished++;
+    };
+
+    // A worker that died or closed its end would otherwise leave the parent waiting on it forever
+    auto failChannel = [&](int i, const char *reason) {
+        std::cerr << "Child " << i << " (PID " << channels[i].pid << ") " << reason << " after "
+                  << channels[i].received << " replies\n";
+        closeChannel(i);
+        failed++;
+    };
+
+    // One handler per channel, all served from this single thread
+    for (int i = 0; i < numChildren; i++) {
+        loop.add(channels[i].replyFd, [&, i](int fd, uint32_t) {
+            Channel &channel = channels[i];
+            char buffer[MESSAGE_SIZE];
+
+            // Hang-ups and errors show up here as a failed or short read
+            if (channel.doorbell) {
+                uint64_t rings;
+                if (read(fd, &rings, sizeof(rings)) != sizeof(rings)) {
+                    failChannel(i, "closed its doorbell");
+                    return;
+                }
+                memcpy(buffer, slots + i * MESSAGE_SIZE, MESSAGE_SIZE);
+            } else if (read(fd, buffer, MESSAGE_SIZE) != static_cast<ssize_t>(MESSAGE_SIZE)) {
+                failChannel(i, "closed its reply pipe");
+                return;
+            }
+            channel.received++;
+
+            if (channel.sent < NUM_MESSAGES) {
+                sendRequest(channel, i);
+            } else {
+                closeChannel(i);
+                if (i == 0)
+                    std::cout << "Last reply from child 0: " << buffer << std::endl;
+            }
+        });
+        sendRequest(channels[i], i);
+    }
+
+    while (finished < numChildren) {
+        if (loop.runOnce(1000) < 0) {
+            perror("event loop error");
+            break;
+        }
+
+        // Workers only exit once their request pipe is closed. A doorbell channel never hangs up,
+        // so a worker that exits while its channel is open is only noticed here
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            for (int i = 0; i < numChildren; i++)
+                if (channels[i].pid == pid && channels[i].open)
+                    failChannel(i, WIFSIGNALED(status) ? "was killed" : "exited early");
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long total = 0;
+    for (const Channel &channel : channels)
+        total += channel.received;
+    std::cout << numChildren << " children, " << total << " round trips in " << seconds << " s ("
+              << total / seconds << " round trips/s)";
+    if (failed > 0)
+        std::cout << ", " << failed << " children failed";
+    std::cout << "\n";
+
+    while (wait(NULL) > 0);  // wait for children to exit
+    return failed > 0 ? 1 : 0;
+}
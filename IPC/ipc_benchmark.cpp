@@ -0,0 +1,566 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sched.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "event_loop.h"
+#include "shm_mailbox.h"
+#include "shm_region.h"
+#include "../Common/histogram.h"
+#include "../Common/numa.h"
+#include "../Common/perf_counters.h"
+
+
+const int DEFAULT_ITERATIONS = 20000;  // ping-pong round trips per configuration
+const int DEFAULT_MESSAGES = 50000;  // messages streamed per producer
+const int SYSV_RING_SLOTS = 64;  // slots in the semaphore guarded ring
+const size_t MAX_MESSAGE_SIZE = 64 * 1024;
+const size_t MAILBOX_MAX_MESSAGE = sizeof(MailboxSlot::data);
+
+// Mechanisms found in IPC/, plus the per-producer mailbox
+enum class Mechanism { FORK, PIPE, SYSV_SEM, SHM_SPIN, MAILBOX };
+const Mechanism ALL_MECHANISMS[] = {Mechanism::FORK, Mechanism::PIPE, Mechanism::SYSV_SEM, Mechanism::SHM_SPIN, Mechanism::MAILBOX};
+
+// Where processes are pinned relative to the measuring (parent) process
+enum class Placement { SAME_CORE, OTHER_CORE, OTHER_NODE };
+
+
+const char *mechanismName(Mechanism m) {
+    switch (m) {
+        case Mechanism::FORK: return "fork";
+        case Mechanism::PIPE: return "pipe";
+        case Mechanism::SYSV_SEM: return "sysv_shm_sem";
+        case Mechanism::SHM_SPIN: return "shm_flag_spin";
+        case Mechanism::MAILBOX: return "shm_mailbox";
+    }
+    return "?";
+}
+
+const char *placementName(Placement p) {
+    switch (p) {
+        case Placement::SAME_CORE: return "same_core";
+        case Placement::OTHER_CORE: return "other_core";
+        case Placement::OTHER_NODE: return "other_node";
+    }
+    return "?";
+}
+
+
+// CPU placement
+// ================================================================================
+
+// CPU for a role: role 0 is the measuring parent, roles 1.. are its peers
+int cpuFor(Placement placement, int role) {
+    const NumaTopology &topology = NumaTopology::instance();
+    const std::vector<int> &home = topology.cpusOf(0);
+
+    if (role == 0 || placement == Placement::SAME_CORE)
+        return home[0];
+
+    if (placement == Placement::OTHER_NODE && topology.nodes() > 1) {
+        const std::vector<int> &remote = topology.cpusOf(1);
+        return remote[(role - 1) % remote.size()];
+    }
+
+    // Other cores on the same node, wrapping around (to core 0 on single core machines)
+    return home[role % home.size()];
+}
+
+void pinToCpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+
+// Helpers
+// ================================================================================
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Spin on a condition, yielding the CPU now and then so a peer on the same core can run
+template <typename Predicate>
+void spinUntil(Predicate done) {
+    for (int spins = 0; !done(); spins++)
+        if (spins % 256 == 255)
+            sched_yield();
+}
+
+bool readFully(int fd, char *buffer, size_t size) {
+    while (size > 0) {
+        ssize_t n = read(fd, buffer, size);
+        if (n <= 0)
+            return false;
+        buffer += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeFully(int fd, const char *buffer, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, buffer, size);
+        if (n <= 0)
+            return false;
+        buffer += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Semaphore P (wait)
+void P(int semid, int semnum) {
+    struct sembuf p_op = {static_cast<short unsigned int>(semnum), -1, 0};
+    semop(semid, &p_op, 1);
+}
+
+// Semaphore V (signal)
+void V(int semid, int semnum) {
+    struct sembuf v_op = {static_cast<short unsigned int>(semnum), 1, 0};
+    semop(semid, &v_op, 1);
+}
+
+void waitChildren() {
+    while (wait(NULL) > 0);
+}
+
+
+// Shared memory layouts
+// ================================================================================
+
+// Ping-pong through shared memory: a spin flag (0 idle, 1 request, 2 reply) and one buffer
+struct PingPongArea {
+    alignas(CACHE_LINE_SIZE) std::atomic<int> flag;
+    alignas(CACHE_LINE_SIZE) char data[MAX_MESSAGE_SIZE];
+};
+
+// Streaming through a semaphore guarded ring shared by all producers
+struct SysvRing {
+    uint64_t tail;  // protected by the mutex semaphore
+    uint64_t head;  // only touched by the consumer
+    char slots[SYSV_RING_SLOTS][MAX_MESSAGE_SIZE];
+};
+
+// Streaming through one flag-guarded slot per producer, as in shared_memory.cpp
+struct alignas(CACHE_LINE_SIZE) SpinSlot {
+    std::atomic<int> flag;  // 0 empty, 1 full
+    alignas(CACHE_LINE_SIZE) char data[MAX_MESSAGE_SIZE];
+};
+
+
+// Ping-pong latency (one way latency = round trip / 2)
+// ================================================================================
+
+bool pingPong(Mechanism mechanism, size_t size, int iterations, Placement placement, LatencyHistogram &histogram) {
+    std::vector<char> message(size, 'x');
+    std::vector<char> reply(size);
+    pinToCpu(cpuFor(placement, 0));
+
+    if (mechanism == Mechanism::FORK) {
+        // Round trip = fork, child touches size bytes (copy on write), exits, parent reaps it
+        for (int i = 0; i < iterations; i++) {
+            uint64_t start = nowNs();
+            pid_t pid = fork();
+            if (pid < 0)
+                return false;
+            if (pid == 0) {
+                pinToCpu(cpuFor(placement, 1));
+                for (size_t offset = 0; offset < size; offset += 4096)
+                    message[offset] = 'y';
+                _exit(0);
+            }
+            waitpid(pid, NULL, 0);
+            histogram.record((nowNs() - start) / 2);
+        }
+        return true;
+    }
+
+    if (mechanism == Mechanism::PIPE) {
+        int toChild[2], toParent[2];
+        if (pipe(toChild) == -1 || pipe(toParent) == -1)
+            return false;
+
+        if (fork() == 0) {
+            pinToCpu(cpuFor(placement, 1));
+            close(toChild[1]);
+            close(toParent[0]);
+            while (readFully(toChild[0], reply.data(), size))
+                writeFully(toParent[1], reply.data(), size);
+            _exit(0);
+        }
+        close(toChild[0]);
+        close(toParent[1]);
+
+        for (int i = 0; i < iterations; i++) {
+            uint64_t start = nowNs();
+            writeFully(toChild[1], message.data(), size);
+            readFully(toParent[0], reply.data(), size);
+            histogram.record((nowNs() - start) / 2);
+        }
+
+        close(toChild[1]);
+        close(toParent[0]);
+        waitChildren();
+        return true;
+    }
+
+    if (mechanism == Mechanism::SYSV_SEM || mechanism == Mechanism::SHM_SPIN) {
+        SharedRegion region;
+        if (!region.create(sizeof(PingPongArea)))
+            return false;
+        PingPongArea *area = new (region.data()) PingPongArea();
+        area->flag.store(0);
+
+        // Semaphore 0: request ready, semaphore 1: reply ready
+        int semId = -1;
+        if (mechanism == Mechanism::SYSV_SEM) {
+            semId = semget(IPC_PRIVATE, 2, IPC_CREAT | 0600);
+            if (semId < 0)
+                return false;
+            semctl(semId, 0, SETVAL, 0);
+            semctl(semId, 1, SETVAL, 0);
+        }
+
+        if (fork() == 0) {
+            pinToCpu(cpuFor(placement, 1));
+            for (int i = 0; i < iterations; i++) {
+                if (semId >= 0)
+                    P(semId, 0);
+                else
+                    spinUntil([&] { return area->flag.load(std::memory_order_acquire) == 1; });
+
+                area->data[0]++;  // touch the message like a real consumer would
+
+                if (semId >= 0)
+                    V(semId, 1);
+                else
+                    area->flag.store(2, std::memory_order_release);
+            }
+            _exit(0);
+        }
+
+        for (int i = 0; i < iterations; i++) {
+            uint64_t start = nowNs();
+            memcpy(area->data, message.data(), size);
+            if (semId >= 0) {
+                V(semId, 0);
+                P(semId, 1);
+            } else {
+                area->flag.store(1, std::memory_order_release);
+                spinUntil([&] { return area->flag.load(std::memory_order_acquire) == 2; });
+            }
+            memcpy(reply.data(), area->data, size);
+            histogram.record((nowNs() - start) / 2);
+        }
+
+        waitChildren();
+        if (semId >= 0)
+            semctl(semId, 0, IPC_RMID);
+        return true;
+    }
+
+    // Mailbox: one single-producer mailbox per direction
+    if (size > MAILBOX_MAX_MESSAGE)
+        return false;
+    SharedRegion region;
+    if (!region.create(2 * Mailbox::bytesFor(1)))
+        return false;
+    Mailbox *requests = Mailbox::create(region.data(), 1);
+    Mailbox *replies = Mailbox::create(static_cast<char*>(region.data()) + Mailbox::bytesFor(1), 1);
+
+    if (fork() == 0) {
+        pinToCpu(cpuFor(placement, 1));
+        for (int i = 0; i < iterations; ) {
+            i += requests->receive([&](int, const char *data, size_t length) {
+                replies->send(0, data, length);
+            });
+        }
+        _exit(0);
+    }
+
+    for (int i = 0; i < iterations; i++) {
+        uint64_t start = nowNs();
+        requests->send(0, message.data(), size);
+        replies->receive([&](int, const char *data, size_t length) { memcpy(reply.data(), data, length); });
+        histogram.record((nowNs() - start) / 2);
+    }
+
+    waitChildren();
+    return true;
+}
+
+
+// Streaming throughput: producers children -> parent consumer. Returns messages per second
+// ================================================================================
+
+double stream(Mechanism mechanism, size_t size, int producers, int messages, Placement placement) {
+    std::vector<char> buffer(std::max(size, static_cast<size_t>(64 * 1024)), 'x');
+    uint64_t total = static_cast<uint64_t>(producers) * messages;
+    pinToCpu(cpuFor(placement, 0));
+
+    // All producers start together once the parent flips the start flag
+    SharedRegion startRegion;
+    if (!startRegion.create(sizeof(std::atomic<int>)))
+        return -1;
+    std::atomic<int> *go = new (startRegion.data()) std::atomic<int>(0);
+
+    uint64_t start = 0;
+
+    if (mechanism == Mechanism::PIPE) {
+        EventLoop loop;
+        if (!loop.init(EventLoop::EPOLL))
+            return -1;
+
+        uint64_t expected = total * size;
+        uint64_t receivedBytes = 0;
+        std::vector<int> readFds;
+        for (int p = 0; p < producers; p++) {
+            int fds[2];
+            if (pipe(fds) == -1)
+                return -1;
+            if (fork() == 0) {
+                pinToCpu(cpuFor(placement, p + 1));
+                for (int fd : readFds)
+                    close(fd);
+                close(fds[0]);
+                spinUntil([&] { return go->load(std::memory_order_acquire) == 1; });
+                for (int i = 0; i < messages; i++)
+                    writeFully(fds[1], buffer.data(), size);
+                _exit(0);
+            }
+            close(fds[1]);
+            readFds.emplace_back(fds[0]);
+            loop.add(fds[0], [&](int fd, uint32_t) {
+                ssize_t n = read(fd, buffer.data(), buffer.size());
+                if (n > 0)
+                    receivedBytes += static_cast<uint64_t>(n);
+                else
+                    loop.remove(fd);
+            });
+        }
+
+        start = nowNs();
+        go->store(1, std::memory_order_release);
+        while (receivedBytes < expected && loop.size() > 0)
+            loop.runOnce(-1);
+
+        for (int fd : readFds)
+            close(fd);
+    } else if (mechanism == Mechanism::SYSV_SEM) {
+        SharedRegion region;
+        if (!region.create(sizeof(SysvRing)))
+            return -1;
+        SysvRing *ring = static_cast<SysvRing*>(region.data());
+        ring->head = ring->tail = 0;
+
+        // Classic bounded buffer: 0 = empty slots, 1 = full slots, 2 = producer mutex
+        int semId = semget(IPC_PRIVATE, 3, IPC_CREAT | 0600);
+        if (semId < 0)
+            return -1;
+        semctl(semId, 0, SETVAL, SYSV_RING_SLOTS);
+        semctl(semId, 1, SETVAL, 0);
+        semctl(semId, 2, SETVAL, 1);
+
+        for (int p = 0; p < producers; p++) {
+            if (fork() == 0) {
+                pinToCpu(cpuFor(placement, p + 1));
+                spinUntil([&] { return go->load(std::memory_order_acquire) == 1; });
+                for (int i = 0; i < messages; i++) {
+                    P(semId, 0);
+                    P(semId, 2);
+                    memcpy(ring->slots[ring->tail % SYSV_RING_SLOTS], buffer.data(), size);
+                    ring->tail++;
+                    V(semId, 2);
+                    V(semId, 1);
+                }
+                _exit(0);
+            }
+        }
+
+        start = nowNs();
+        go->store(1, std::memory_order_release);
+        for (uint64_t i = 0; i < total; i++) {
+            P(semId, 1);
+            memcpy(buffer.data(), ring->slots[ring->head % SYSV_RING_SLOTS], size);
+            ring->head++;
+            V(semId, 0);
+        }
+        semctl(semId, 0, IPC_RMID);
+    } else if (mechanism == Mechanism::SHM_SPIN) {
+        SharedRegion region;
+        if (!region.create(static_cast<size_t>(producers) * sizeof(SpinSlot)))
+            return -1;
+        SpinSlot *slots = static_cast<SpinSlot*>(region.data());
+        for (int p = 0; p < producers; p++)
+            new (&slots[p]) SpinSlot();
+
+        for (int p = 0; p < producers; p++) {
+            if (fork() == 0) {
+                pinToCpu(cpuFor(placement, p + 1));
+                spinUntil([&] { return go->load(std::memory_order_acquire) == 1; });
+                for (int i = 0; i < messages; i++) {
+                    spinUntil([&] { return slots[p].flag.load(std::memory_order_acquire) == 0; });
+                    memcpy(slots[p].data, buffer.data(), size);
+                    slots[p].flag.store(1, std::memory_order_release);
+                }
+                _exit(0);
+            }
+        }
+
+        start = nowNs();
+        go->store(1, std::memory_order_release);
+        uint64_t received = 0;
+        for (int spins = 0; received < total; ) {
+            bool any = false;
+            for (int p = 0; p < producers; p++) {
+                if (slots[p].flag.load(std::memory_order_acquire) == 1) {
+                    memcpy(buffer.data(), slots[p].data, size);
+                    slots[p].flag.store(0, std::memory_order_release);
+                    received++;
+                    any = true;
+                }
+            }
+            if (!any && ++spins % 256 == 0)
+                sched_yield();
+        }
+    } else if (mechanism == Mechanism::MAILBOX) {
+        if (size > MAILBOX_MAX_MESSAGE)
+            return -1;
+        SharedRegion region;
+        if (!region.create(Mailbox::bytesFor(producers)))
+            return -1;
+        Mailbox *mailbox = Mailbox::create(region.data(), producers);
+
+        for (int p = 0; p < producers; p++) {
+            if (fork() == 0) {
+                pinToCpu(cpuFor(placement, p + 1));
+                spinUntil([&] { return go->load(std::memory_order_acquire) == 1; });
+                for (int i = 0; i < messages; i++)
+                    mailbox->send(p, buffer.data(), size);
+                _exit(0);
+            }
+        }
+
+        start = nowNs();
+        go->store(1, std::memory_order_release);
+        uint64_t received = 0;
+        while (received < total) {
+            received += mailbox->receive([&](int, const char *data, size_t length) {
+                memcpy(buffer.data(), data, length);
+            });
+        }
+    } else {
+        return -1;  // fork has no streaming form
+    }
+
+    double seconds = (nowNs() - start) / 1e9;
+    waitChildren();
+    return total / seconds;
+}
+
+
+// Driver
+// ================================================================================
+
+std::vector<int> parseIntList(const char *text) {
+    std::vector<int> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        values.emplace_back(atoi(item.c_str()));
+    return values;
+}
+
+
+int main(int argc, char *argv[]) {
+    int iterations = DEFAULT_ITERATIONS;
+    int messages = DEFAULT_MESSAGES;
+    std::vector<int> sizes = {8, 64, 256, 4096, 65536};
+    std::vector<int> producerCounts = {1, 2, 4, 8};
+    std::vector<Placement> placements = {Placement::SAME_CORE, Placement::OTHER_CORE, Placement::OTHER_NODE};
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--iterations")
+            iterations = atoi(argv[i + 1]);
+        else if (option == "--messages")
+            messages = atoi(argv[i + 1]);
+        else if (option == "--sizes")
+            sizes = parseIntList(argv[i + 1]);
+        else if (option == "--producers")
+            producerCounts = parseIntList(argv[i + 1]);
+        else if (option == "--placement") {
+            std::string value = argv[i + 1];
+            placements.clear();
+            if (value == "same_core" || value == "all")
+                placements.emplace_back(Placement::SAME_CORE);
+            if (value == "other_core" || value == "all")
+                placements.emplace_back(Placement::OTHER_CORE);
+            if (value == "other_node" || value == "all")
+                placements.emplace_back(Placement::OTHER_NODE);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--iterations N] [--messages N] [--sizes a,b,..]"
+                      << " [--producers a,b,..] [--placement same_core|other_core|other_node|all]\n";
+            return 1;
+        }
+    }
+
+    if (NumaTopology::instance().nodes() < 2)
+        std::cerr << "Note: single NUMA node, other_node runs use other cores of node 0\n";
+
+    // CSV report on stdout. Counters cover the parent and its children, per round trip or message
+    std::cout << "mechanism,test,placement,message_size,producers,samples,p50_ns,p99_ns,p999_ns,max_ns,msgs_per_s,mb_per_s"
+              << perfCsvHeader() << '\n';
+    PerfCounters counters;
+
+    for (Placement placement : placements) {
+        for (int size : sizes) {
+            if (size <= 0 || static_cast<size_t>(size) > MAX_MESSAGE_SIZE)
+                continue;
+
+            for (Mechanism mechanism : ALL_MECHANISMS) {
+                LatencyHistogram histogram;
+                int rounds = (mechanism == Mechanism::FORK) ? std::max(1, iterations / 20) : iterations;
+                counters.start();
+                bool measured = pingPong(mechanism, size, rounds, placement, histogram);
+                PerfSample perf = counters.stop();
+                if (measured) {
+                    std::cout << mechanismName(mechanism) << ",pingpong," << placementName(placement) << ','
+                              << size << ",1," << histogram.count() << ',' << histogram.percentile(0.50) << ','
+                              << histogram.percentile(0.99) << ',' << histogram.percentile(0.999) << ','
+                              << histogram.max() << ",," << perf.csv(histogram.count()) << std::endl;
+                }
+
+                for (int producers : producerCounts) {
+                    if (producers <= 0)
+                        continue;
+                    counters.start();
+                    double rate = stream(mechanism, size, producers, messages, placement);
+                    PerfSample perf = counters.stop();
+                    if (rate < 0)
+                        continue;
+                    uint64_t total = static_cast<uint64_t>(producers) * messages;
+                    std::cout << mechanismName(mechanism) << ",stream," << placementName(placement) << ','
+                              << size << ',' << producers << ',' << total << ",,,,," << static_cast<uint64_t>(rate)
+                              << ',' << rate * size / 1e6 << perf.csv(total) << std::endl;
+                }
+            }
+        }
+    }
+}
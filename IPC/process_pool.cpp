@@ -0,0 +1,428 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "shm_region.h"
+#include "../Common/trace.h"
+
+
+const int NUM_WORKERS = 4;  // default pool size, can be overridden by argv[1]
+const int NUM_TASKS = 200;  // default number of tasks, can be overridden by argv[2]
+const size_t QUEUE_CAPACITY = 256;
+const int MONITOR_INTERVAL_MS = 20;  // how often the parent checks on its workers while waiting
+
+
+struct Task {
+    uint64_t id;
+    uint64_t input;
+};
+
+struct Result {
+    uint64_t id;
+    uint64_t output;
+    int worker;
+};
+
+// Per-worker bookkeeping, used to re-queue the task a crashed worker was running. The queues claim
+// and release the task under their mutex, so there is no point at which a worker can die holding a
+// task the slot doesn't show
+struct WorkerSlot {
+    pid_t pid;
+    volatile bool busy;
+    Task current;
+    uint64_t tasksDone;
+};
+
+
+// Lock a robust process-shared mutex. If the previous owner died while holding it the mutex is
+// marked consistent again; the queues only publish with a single store so their state stays valid
+void lockRobust(pthread_mutex_t *mutex) {
+    if (pthread_mutex_lock(mutex) == EOWNERDEAD)
+        pthread_mutex_consistent(mutex);
+}
+
+// Wait on a condition variable for at most ms milliseconds, recovering the mutex like lockRobust
+void timedWait(pthread_cond_t *cond, pthread_mutex_t *mutex, int ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += static_cast<long>(ms) * 1000000;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+    if (pthread_cond_timedwait(cond, mutex, &deadline) == EOWNERDEAD)
+        pthread_mutex_consistent(mutex);
+}
+
+
+// Bounded MPMC queue living in shared memory. head and tail only ever grow, and each operation
+// publishes with one store after copying the item, so a process dying mid-operation can't corrupt it
+template <typename T>
+struct SharedQueue {
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    uint64_t head;
+    uint64_t tail;
+    bool closed;
+    T items[QUEUE_CAPACITY];
+
+    void init() {
+        pthread_mutexattr_t mutexAttr;
+        pthread_mutexattr_init(&mutexAttr);
+        pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&mutex, &mutexAttr);
+        pthread_mutexattr_destroy(&mutexAttr);
+
+        pthread_condattr_t condAttr;
+        pthread_condattr_init(&condAttr);
+        pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+        pthread_cond_init(&notEmpty, &condAttr);
+        pthread_cond_init(&notFull, &condAttr);
+        pthread_condattr_destroy(&condAttr);
+
+        head = tail = 0;
+        closed = false;
+    }
+
+    // Returns false if the queue is full (or closed) and wait is false
+    bool push(const T &item, bool wait) {
+        if (!waitForRoom(wait))
+            return false;
+        finishPush(item);
+        return true;
+    }
+
+    // push() for a worker's result: also releases the task the worker claimed in pop(). A worker
+    // dying between the publish and the release gets its task re-run; the duplicate result is dropped
+    bool push(const T &item, bool wait, WorkerSlot &claim) {
+        if (!waitForRoom(wait))
+            return false;
+        items[tail % QUEUE_CAPACITY] = item;
+        tail = tail + 1;  // publish
+        claim.busy = false;
+        pthread_cond_signal(&notEmpty);
+        pthread_mutex_unlock(&mutex);
+        return true;
+    }
+
+    // Waits at most timeoutMs (forever if negative); returns false on timeout or when closed and empty
+    bool pop(T &item, int timeoutMs) {
+        if (!waitForItem(timeoutMs))
+            return false;
+        finishPop(item);
+        return true;
+    }
+
+    // pop() for a worker: records the task in its slot before taking it off the queue, so a worker
+    // dying at any point afterwards has its task re-queued by the supervisor
+    bool pop(T &item, int timeoutMs, WorkerSlot &claim) {
+        if (!waitForItem(timeoutMs))
+            return false;
+        claim.current = items[head % QUEUE_CAPACITY];
+        claim.busy = true;
+        finishPop(item);
+        return true;
+    }
+
+    void close() {
+        lockRobust(&mutex);
+        closed = true;
+        pthread_cond_broadcast(&notEmpty);
+        pthread_cond_broadcast(&notFull);
+        pthread_mutex_unlock(&mutex);
+    }
+
+private:
+    // Lock and wait for a free slot. Returns false, unlocked, if there is none and wait is false or
+    // the queue is closed; otherwise true with the mutex still held
+    bool waitForRoom(bool wait) {
+        lockRobust(&mutex);
+        while (tail - head == QUEUE_CAPACITY && !closed) {
+            if (!wait) {
+                pthread_mutex_unlock(&mutex);
+                return false;
+            }
+            timedWait(&notFull, &mutex, MONITOR_INTERVAL_MS);
+        }
+        if (closed) {
+            pthread_mutex_unlock(&mutex);
+            return false;
+        }
+        return true;
+    }
+
+    void finishPush(const T &item) {
+        items[tail % QUEUE_CAPACITY] = item;
+        tail = tail + 1;  // publish
+
+        pthread_cond_signal(&notEmpty);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    // Lock and wait for an item like pop(). Returns true with the mutex still held
+    bool waitForItem(int timeoutMs) {
+        lockRobust(&mutex);
+        while (tail == head && !closed) {
+            if (timeoutMs >= 0) {
+                timedWait(&notEmpty, &mutex, timeoutMs);
+                if (tail == head)
+                    break;
+            } else {
+                timedWait(&notEmpty, &mutex, MONITOR_INTERVAL_MS);
+            }
+        }
+        if (tail == head) {
+            pthread_mutex_unlock(&mutex);
+            return false;
+        }
+        return true;
+    }
+
+    void finishPop(T &item) {
+        item = items[head % QUEUE_CAPACITY];
+        head = head + 1;  // publish
+
+        pthread_cond_signal(&notFull);
+        pthread_mutex_unlock(&mutex);
+    }
+};
+
+
+struct PoolMemory {
+    SharedQueue<Task> tasks;
+    SharedQueue<Result> results;
+    volatile bool crashOnce;  // demo only: makes one worker crash to exercise the respawn path
+    WorkerSlot workers[1];  // numWorkers entries follow
+};
+
+
+typedef uint64_t (*TransformFn)(uint64_t);
+
+
+// Pre-forked pool of worker processes pulling tasks from a shared queue
+class ProcessPool {
+public:
+    // Fork numWorkers workers, pinned round-robin over the available cores
+    bool start(int numWorkers, TransformFn fn, bool crashDemo) {
+        workerCount = numWorkers;
+        transform = fn;
+
+        RegionOptions options;
+        options.populate = true;
+        size_t bytes = sizeof(PoolMemory) + static_cast<size_t>(numWorkers) * sizeof(WorkerSlot);
+        if (!region.create(bytes, options)) {
+            perror("shared region error");
+            return false;
+        }
+
+        shared = static_cast<PoolMemory*>(region.data());
+        shared->tasks.init();
+        shared->results.init();
+        shared->crashOnce = crashDemo;
+        for (int i = 0; i < numWorkers; i++) {
+            shared->workers[i].busy = false;
+            shared->workers[i].tasksDone = 0;
+        }
+        completed.assign(0, false);
+
+        for (int i = 0; i < numWorkers; i++)
+            if (!spawn(i))
+                return false;
+        return true;
+    }
+
+    // Queue a task; returns false instead of blocking when the task queue is full
+    bool trySubmit(const Task &task) {
+        return shared->tasks.push(task, false);
+    }
+
+    // Wait up to timeoutMs for a result. Dead workers are detected and replaced while waiting.
+    // Duplicate results (a worker that died after publishing) are dropped
+    bool collect(Result &result, int timeoutMs) {
+        while (true) {
+            reapWorkers();
+            if (!shared->results.pop(result, std::min(timeoutMs, MONITOR_INTERVAL_MS))) {
+                timeoutMs -= MONITOR_INTERVAL_MS;
+                if (timeoutMs <= 0)
+                    return false;
+                continue;
+            }
+
+            if (result.id >= completed.size())
+                completed.resize(result.id + 1, false);
+            if (completed[result.id])
+                continue;
+            completed[result.id] = true;
+            return true;
+        }
+    }
+
+    // Close the task queue, let the workers drain it and wait for all of them to exit
+    void shutdown() {
+        shared->tasks.close();
+        for (int i = 0; i < workerCount; i++) {
+            int status;
+            while (waitpid(shared->workers[i].pid, &status, 0) == -1 && errno == EINTR);
+        }
+        shared->results.close();
+    }
+
+    int respawns() const { return respawnCount; }
+    uint64_t tasksDone(int worker) const { return shared->workers[worker].tasksDone; }
+
+private:
+    bool spawn(int worker) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork error");
+            return false;
+        }
+
+        if (pid == 0) {  // worker
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(worker % sysconf(_SC_NPROCESSORS_ONLN), &cpus);
+            sched_setaffinity(0, sizeof(cpus), &cpus);
+
+            TRACE_THREAD_NAME("worker", worker);
+            workerLoop(worker);
+            TRACE_FLUSH();  // _exit skips the tracer's destructor
+            _exit(0);
+        }
+
+        shared->workers[worker].pid = pid;
+        return true;
+    }
+
+    void workerLoop(int worker) {
+        WorkerSlot &slot = shared->workers[worker];
+        Task task;
+
+        // Workers pull from the shared queue, so faster workers naturally take more tasks
+        while (shared->tasks.pop(task, -1, slot)) {
+
+            if (shared->crashOnce && task.id == 7) {
+                shared->crashOnce = false;
+                abort();
+            }
+
+            TRACE_BEGIN("task");
+            Result result = {task.id, transform(task.input), worker};
+            TRACE_END("task");
+            shared->results.push(result, true, slot);
+            slot.tasksDone++;
+        }
+    }
+
+    // Replace every worker that exited while the pool is running, re-queueing its task
+    void reapWorkers() {
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            for (int i = 0; i < workerCount; i++) {
+                WorkerSlot &slot = shared->workers[i];
+                if (slot.pid != pid)
+                    continue;
+
+                std::cerr << "Worker " << i << " (PID " << pid << ") died";
+                if (WIFSIGNALED(status))
+                    std::cerr << " from signal " << WTERMSIG(status);
+                std::cerr << ", respawning\n";
+
+                // Respawn before re-queueing: with every worker dead and the queue full, the push would
+                // never return. The replacement reuses the slot, so take the lost task out of it first
+                bool lost = slot.busy;
+                Task task = slot.current;
+                slot.busy = false;
+                respawnCount++;
+                spawn(i);
+                if (lost)
+                    shared->tasks.push(task, true);
+            }
+        }
+    }
+
+    SharedRegion region;
+    PoolMemory *shared = nullptr;
+    TransformFn transform = nullptr;
+    int workerCount = 0;
+    int respawnCount = 0;
+    std::vector<bool> completed;
+};
+
+
+// CPU-heavy transform: count the primes below n by trial division
+uint64_t countPrimes(uint64_t n) {
+    uint64_t count = 0;
+    for (uint64_t i = 2; i < n; i++) {
+        bool prime = true;
+        for (uint64_t d = 2; d * d <= i; d++) {
+            if (i % d == 0) {
+                prime = false;
+                break;
+            }
+        }
+        if (prime)
+            count++;
+    }
+    return count;
+}
+
+
+int main(int argc, char *argv[]) {
+    int numWorkers = (argc > 1) ? atoi(argv[1]) : NUM_WORKERS;
+    int numTasks = (argc > 2) ? atoi(argv[2]) : NUM_TASKS;
+    bool crashDemo = (argc > 3) && strcmp(argv[3], "--crash") == 0;
+
+    if (numWorkers <= 0 || numTasks <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [num_workers] [num_tasks] [--crash]\n";
+        return 1;
+    }
+
+    TRACE_START("process_pool.trace.json");  // workers append to the same timeline
+    TRACE_THREAD_NAME("supervisor");
+
+    ProcessPool pool;
+    if (!pool.start(numWorkers, countPrimes, crashDemo))
+        return 1;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Task sizes vary, so the pull-based queue balances the load between workers
+    // A task that didn't fit is retried as is, so the inputs and the checksum don't depend on timing
+    int submitted = 0;
+    int received = 0;
+    uint64_t checksum = 0;
+    Task next = {0, 1000 + static_cast<uint64_t>(rand() % 20000)};
+    while (received < numTasks) {
+        while (submitted < numTasks && pool.trySubmit(next)) {
+            submitted++;
+            next = {static_cast<uint64_t>(submitted), 1000 + static_cast<uint64_t>(rand() % 20000)};
+        }
+
+        Result result;
+        if (pool.collect(result, 1000)) {
+            checksum += result.output;
+            received++;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    pool.shutdown();
+    TRACE_STOP();
+
+    std::cout << "Processed " << received << " tasks in " << seconds << " s (" << received / seconds << " tasks/s)\n";
+    std::cout << "Checksum: " << checksum << " ; Respawns: " << pool.respawns() << std::endl;
+    for (int i = 0; i < numWorkers; i++)
+        std::cout << "Worker " << i << " completed " << pool.tasksDone(i) << " tasks\n";
+}
@@ -1,106 +1,72 @@
-#include <sys/ipc.h>
-#include <sys/shm.h>
-#include <sys/sem.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <iostream>
-#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include "shm_mailbox.h"
+#include "shm_region.h"
+#include "../Common/trace.h"
 
 
-const int NUM_CHILDREN = 4;
+const int NUM_CHILDREN = 4;  // default number of producers, can be overridden by argv[1]
 const int NUM_MESSAGES = 5;
 
 
-// Shared memory struct
-struct SharedMemory {
-    char messages[NUM_CHILDREN][256];
-    int status[NUM_CHILDREN];
-};
+int main(int argc, char *argv[]) {
+    SharedRegion region;
+    RegionOptions options;
+    int numChildren = (argc > 1) ? atoi(argv[1]) : NUM_CHILDREN;
 
-// Semaphore P (wait)
-void P(int semid, int semnum) {
-    struct sembuf p_op = {static_cast<short unsigned int>(semnum), -1, 0};
-    semop(semid, &p_op, 1);
-}
-
-// Semaphore V (signal)
-void V(int semid, int semnum) {
-    struct sembuf v_op = {static_cast<short unsigned int>(semnum), 1, 0};
-    semop(semid, &v_op, 1);
-}
-
-
-int main() {
-    int shmId;
-    int semId;
-    key_t key = 1234;  // hardcoded key for shared memory and semaphore
-    SharedMemory* shmPtr;
-
-    // Shared memory
-    shmId = shmget(key, sizeof(SharedMemory), IPC_CREAT | 0666);
-    if (shmId < 0) {
-        std::cerr << "Error creating the shared memory\n";
-        return 1;
-    }
-
-    // Shared memory attachment
-    shmPtr = (SharedMemory*)shmat(shmId, NULL, 0);
-    if ((long)shmPtr == -1) {
-        std::cerr << "Error attaching the shared memory\n";
+    if (numChildren <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [num_children]\n";
         return 1;
     }
 
-    // Shared memory initialization
-    memset(shmPtr->messages, 0, sizeof(shmPtr->messages));
-    for (int i = 0; i < NUM_CHILDREN; ++i)
-        shmPtr->status[i] = 0;
+    // Large mailboxes benefit from huge pages; pre-fault so no child pays for first touch
+    options.hugePages = Mailbox::bytesFor(numChildren) >= HUGE_PAGE_SIZE;
+    options.populate = true;
 
-    // Semaphore creation
-    semId = semget(key, 2, IPC_CREAT | 0666);
-    if (semId < 0) {
-        std::cerr << "Error creating semaphores\n";
+    // Shared memory sized for one ring per child
+    if (!region.create(Mailbox::bytesFor(numChildren), options)) {
+        std::cerr << "Error creating the shared memory: " << strerror(errno) << "\n";
         return 1;
     }
 
-    // Initialize semaphores
-    semctl(semId, 0, SETVAL, 1);
-    semctl(semId, 1, SETVAL, 0);
+    TRACE_START("process_sync.trace.json");  // children append to the same timeline
+    TRACE_THREAD_NAME("parent");
+
+    // Mailbox initialization
+    Mailbox *mailbox = Mailbox::create(region.data(), numChildren);
 
-    // Fork child processes
-    for (int i = 0; i < NUM_CHILDREN; ++i) {
+    // Fork child processes; each one writes only to its own ring
+    for (int i = 0; i < numChildren; ++i) {
         if (fork() == 0) {
+            TRACE_THREAD_NAME("child", i);
+            char message[64];
             for (int j = 0; j < NUM_MESSAGES; ++j) {
-                P(semId, 0);  // wait for write access
-
-                sprintf(shmPtr->messages[i], "Message: %d, from child: %d", j, i);  // write message
-                shmPtr->status[i] = 1;  // indicate pending message
-
-                V(semId, 1);  // signal that a message is available
+                int length = snprintf(message, sizeof(message), "Message: %d, from child: %d", j, i);
+                TRACE_INSTANT("send", j);
+                mailbox->send(i, message, length);  // publish message, wakes parent only if idle
                 sleep(1);  // wait before sending the following message
             }
             return 0;
         }
     }
 
-    // Parent process
-    for (int i = 0; i < NUM_CHILDREN * 5; ++i) {
-        P(semId, 1);  // wait for message
-
-        // Scan for messages
-        for (int j = 0; j < NUM_CHILDREN; ++j) {
-            if (shmPtr->status[j] == 1) {  // check for new message
-                std::cout << "Received: " << shmPtr->messages[j] << std::endl;
-                shmPtr->status[j] = 0;
-
-                V(semId, 0);  // signal message processed
-                break;
-            }
-        }
+    // Parent process: drain every ready message in one pass, sleep when there are none
+    int received = 0;
+    while (received < numChildren * NUM_MESSAGES) {
+        // Messages are not NUL terminated (send() may also truncate them), so print length bytes
+        received += mailbox->receive([](int producer, const char *data, size_t length) {
+            TRACE_INSTANT("receive", producer);
+            std::cout << "Received: " << std::string_view(data, length) << std::endl;
+        });
     }
 
-    shmdt((void *) shmPtr);  // detach shared memory
+    while (wait(NULL) > 0);  // wait for children to exit
+    TRACE_STOP();
 
-    // Remove shared memory and semaphores
-    shmctl(shmId, IPC_RMID, NULL);
-    semctl(semId, 0, IPC_RMID);
+    region.release();  // unmap and close shared memory
 }
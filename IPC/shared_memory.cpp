@@ -1,11 +1,10 @@
 #include <iostream>
-#include <sys/ipc.h>
-#include <sys/shm.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <cstring>
 #include <cctype>
 #include <sys/wait.h>
+#include "shm_region.h"
 
 
 // Shared data struct
@@ -25,22 +24,16 @@ void to_uppercase(char *str) {
 
 
 int main() {
-    key_t shm_key = IPC_PRIVATE;  // use hardcoded key
+    SharedRegion region;
+    RegionOptions options;
+    options.populate = true;  // fault the page in now rather than on the first message
 
-    // Create shared memory
-    int shm_id = shmget(shm_key, sizeof(SharedData), 0666 | IPC_CREAT);
-    if (shm_id == -1) {
-        perror("shmget error");
-        return 1;
-    }
-
-    // Attach to shared memory
-    SharedData *shared_data = static_cast<SharedData*>(shmat(shm_id, nullptr, 0));
-    if (reinterpret_cast<intptr_t>(shared_data) == -1) {
-        perror("shmat error");
-        shmctl(shm_id, IPC_RMID, nullptr);
+    // Create and map anonymous shared memory, inherited by the child across fork
+    if (!region.create(sizeof(SharedData), options)) {
+        perror("shared region error");
         return 1;
     }
+    SharedData *shared_data = static_cast<SharedData*>(region.data());
 
     shared_data->flag = 0;  // initialize shared data unlocked
 
@@ -48,8 +41,6 @@ int main() {
     pid_t pid = fork();
     if (pid == -1) {
         perror("fork error");
-        shmdt(shared_data);
-        shmctl(shm_id, IPC_RMID, nullptr);
         return 1;
     }
 
@@ -72,8 +63,8 @@ int main() {
             shared_data->flag = 0;  // reset flag to indicate processing is done
         }
 
-        // Detach from shared memory
-        shmdt(shared_data);
+        // Unmap shared memory
+        region.release();
         _exit(0);
     }
     else {  // parent
@@ -108,8 +99,7 @@ int main() {
 
         wait(nullptr);  // wait for child to exit
 
-        // Detach and remove shared memory
-        shmdt(shared_data);
-        shmctl(shm_id, IPC_RMID, nullptr);
+        // Unmap and close shared memory, nothing is left behind if the program crashes
+        region.release();
     }
 }
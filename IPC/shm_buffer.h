@@ -0,0 +1,285 @@
+#ifndef SHM_BUFFER_H
+#define SHM_BUFFER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <pthread.h>
+#include "shm_mailbox.h"
+#include "shm_region.h"
+
+
+const uint32_t SHM_BUFFER_MAGIC = 0x53484d42;  // "SHMB", written last by the creator
+
+
+// Control block at the start of the region, followed by the slots. Everything but magic is
+// guarded by mutex; the futex words are atomics only because waiters sleep on them unlocked
+struct alignas(CACHE_LINE_SIZE) ShmBufferHeader {
+    std::atomic<uint32_t> magic;
+    uint32_t capacity;  // slots
+    uint32_t maxMessage;  // bytes per message
+    pthread_mutex_t mutex;  // process-shared and robust
+    uint64_t readPos;  // sequence number of the next slot to be read
+    uint64_t writePos;  // sequence number of the next slot to be written
+    uint64_t recoveries;  // times a holder died with the mutex locked
+    uint32_t closed;
+    uint32_t emptyWaiters;  // asleep on notEmpty
+    uint32_t fullWaiters;  // asleep on notFull
+    std::atomic<uint32_t> notEmpty;  // bumped to wake receivers
+    std::atomic<uint32_t> notFull;  // bumped to wake senders
+};
+
+
+// The bounded buffer of Bounded_Buffer/ across processes: a ring of fixed-size message slots in a
+// named shared memory region, so producer and consumer processes can attach to it by name.
+//
+// A process-shared robust mutex guards the ring and waiters sleep on futex words next to it. If a
+// process dies holding the mutex, the next process to lock it gets EOWNERDEAD from the kernel and
+// takes over. A send or receive only commits with its final single store of writePos or readPos
+// (the message is copied before that), so a peer killed mid-operation leaves the ring as it was
+// before or after the operation and no slot is left half written or stuck. Wakeups are issued while
+// the mutex is held, so a process dying right after its commit can't swallow one either.
+//
+// A process only trusts the geometry it read when it created or attached, so a misbehaving peer
+// scribbling over the control block can't make it index or copy outside the region
+class ShmBuffer {
+public:
+    ShmBuffer() {}
+
+    ShmBuffer(const ShmBuffer&) = delete;
+    ShmBuffer &operator=(const ShmBuffer&) = delete;
+
+    static size_t bytesFor(uint32_t capacity, size_t maxMessage) {
+        return sizeof(ShmBufferHeader) + static_cast<size_t>(capacity) * slotStrideFor(maxMessage);
+    }
+
+    // Create the region and the buffer in it. If name is nullptr a unique name is generated; see
+    // name(). Returns false and leaves errno set on failure
+    bool create(const char *name, uint32_t capacity, size_t maxMessage,
+                const RegionOptions &options = RegionOptions()) {
+        if (capacity == 0 || maxMessage == 0 || maxMessage > UINT32_MAX) {
+            errno = EINVAL;
+            return false;
+        }
+        if (!region.createNamed(name, bytesFor(capacity, maxMessage), options))
+            return false;
+
+        header = new (region.data()) ShmBufferHeader();
+        header->capacity = capacity;
+        header->maxMessage = static_cast<uint32_t>(maxMessage);
+        header->readPos = header->writePos = header->recoveries = 0;
+        header->closed = header->emptyWaiters = header->fullWaiters = 0;
+        header->notEmpty.store(0, std::memory_order_relaxed);
+        header->notFull.store(0, std::memory_order_relaxed);
+
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        int error = pthread_mutex_init(&header->mutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+        if (error != 0) {
+            region.release();
+            header = nullptr;
+            errno = error;
+            return false;
+        }
+
+        useGeometry(capacity, maxMessage);
+        header->magic.store(SHM_BUFFER_MAGIC, std::memory_order_release);
+        return true;
+    }
+
+    // Attach to a buffer created by another process. Fails with EAGAIN if the creator hasn't
+    // finished initializing it yet and with EINVAL if the region doesn't hold a buffer
+    bool attach(const char *name, const RegionOptions &options = RegionOptions()) {
+        if (!region.attach(name, options))
+            return false;
+        header = static_cast<ShmBufferHeader*>(region.data());
+
+        int error = 0;
+        if (region.size() < sizeof(ShmBufferHeader))
+            error = EINVAL;
+        else if (header->magic.load(std::memory_order_acquire) != SHM_BUFFER_MAGIC)
+            error = EAGAIN;
+        else if (header->capacity == 0 || header->maxMessage == 0 ||
+                 region.size() < bytesFor(header->capacity, header->maxMessage))
+            error = EINVAL;
+        if (error != 0) {
+            region.release();
+            header = nullptr;
+            errno = error;
+            return false;
+        }
+
+        useGeometry(header->capacity, header->maxMessage);
+        return true;
+    }
+
+    // Copy a message into the next free slot, blocking while the buffer is full. Longer messages are
+    // truncated to maxMessageSize(). Returns false (errno EPIPE) once the buffer is closed
+    bool send(const void *message, size_t length) {
+        if (length > maxMessage)
+            length = maxMessage;
+        if (!lock())
+            return false;
+
+        while (header->writePos - header->readPos >= slotCount && !header->closed) {
+            uint32_t seen = header->notFull.load(std::memory_order_relaxed);
+            header->fullWaiters++;
+            pthread_mutex_unlock(&header->mutex);
+            futexWait(&header->notFull, seen);
+            if (!lock())
+                return false;
+        }
+        if (header->closed) {
+            pthread_mutex_unlock(&header->mutex);
+            errno = EPIPE;
+            return false;
+        }
+
+        char *slot = slotAt(header->writePos);
+        uint32_t length32 = static_cast<uint32_t>(length);
+        memcpy(slot, &length32, sizeof(length32));
+        memcpy(slot + sizeof(length32), message, length);
+        header->writePos++;  // commit
+
+        if (header->emptyWaiters > 0)
+            wake(header->notEmpty, header->emptyWaiters);
+        pthread_mutex_unlock(&header->mutex);
+        return true;
+    }
+
+    // Copy the oldest message into message (at most maxLength bytes) and its full length into
+    // length, blocking while the buffer is empty. Returns false once it is closed and drained
+    bool receive(void *message, size_t maxLength, size_t &length) {
+        if (!lock())
+            return false;
+
+        while (header->writePos == header->readPos && !header->closed) {
+            uint32_t seen = header->notEmpty.load(std::memory_order_relaxed);
+            header->emptyWaiters++;
+            pthread_mutex_unlock(&header->mutex);
+            futexWait(&header->notEmpty, seen);
+            if (!lock())
+                return false;
+        }
+        if (header->writePos == header->readPos) {
+            pthread_mutex_unlock(&header->mutex);
+            errno = EPIPE;
+            return false;
+        }
+
+        const char *slot = slotAt(header->readPos);
+        uint32_t length32;
+        memcpy(&length32, slot, sizeof(length32));
+        length = length32 < maxMessage ? length32 : maxMessage;
+        memcpy(message, slot + sizeof(length32), length < maxLength ? length : maxLength);
+        header->readPos++;  // commit
+
+        // Let senders pile up until half the ring is free, then wake them all at once
+        if (header->fullWaiters > 0 && header->writePos - header->readPos <= slotCount / 2)
+            wake(header->notFull, header->fullWaiters);
+        pthread_mutex_unlock(&header->mutex);
+        return true;
+    }
+
+    // Wake everyone; sends fail from now on, receives drain what is left
+    void close() {
+        if (!lock())
+            return;
+        header->closed = 1;
+        wakeAll();
+        pthread_mutex_unlock(&header->mutex);
+    }
+
+    size_t size() {
+        if (!lock())
+            return 0;
+        size_t count = static_cast<size_t>(header->writePos - header->readPos);
+        pthread_mutex_unlock(&header->mutex);
+        return count;
+    }
+
+    uint64_t recoveries() {
+        if (!lock())
+            return 0;
+        uint64_t count = header->recoveries;
+        pthread_mutex_unlock(&header->mutex);
+        return count;
+    }
+
+    uint32_t capacity() const { return slotCount; }
+    size_t maxMessageSize() const { return maxMessage; }
+    const char *name() const { return region.name(); }
+
+    // Unmap; the creator also unlinks the name, processes already attached keep their mapping
+    void release() {
+        region.release();
+        header = nullptr;
+        slots = nullptr;
+    }
+
+private:
+    static size_t slotStrideFor(size_t maxMessage) {
+        return (sizeof(uint32_t) + maxMessage + 7) / 8 * 8;
+    }
+
+    void useGeometry(uint32_t capacity, size_t messageSize) {
+        slotCount = capacity;
+        maxMessage = messageSize;
+        slotStride = slotStrideFor(messageSize);
+        slots = static_cast<char*>(region.data()) + sizeof(ShmBufferHeader);
+    }
+
+    char *slotAt(uint64_t position) const {
+        return slots + (position % slotCount) * slotStride;
+    }
+
+    // Lock the control block, taking it over if its holder died
+    bool lock() {
+        int error = pthread_mutex_lock(&header->mutex);
+        if (error == EOWNERDEAD) {
+            recover();
+            pthread_mutex_consistent(&header->mutex);
+        } else if (error != 0) {
+            errno = error;
+            return false;
+        }
+        return true;
+    }
+
+    // The dead holder either committed its operation or didn't, so the ring itself is intact. Only
+    // positions written by a misbehaving peer need repair; waiters are woken to re-check everything
+    void recover() {
+        header->recoveries++;
+        if (header->writePos - header->readPos > slotCount)
+            header->readPos = header->writePos - slotCount;
+        wakeAll();
+    }
+
+    // Wake every waiter on word. Waiters count themselves in before sleeping and the waker counts
+    // them all out, so the count of a waiter that died asleep is dropped at the next wakeup
+    void wake(std::atomic<uint32_t> &word, uint32_t &waiters) {
+        waiters = 0;
+        word.fetch_add(1, std::memory_order_relaxed);
+        futexWake(&word, INT32_MAX);
+    }
+
+    void wakeAll() {
+        wake(header->notEmpty, header->emptyWaiters);
+        wake(header->notFull, header->fullWaiters);
+    }
+
+    SharedRegion region;
+    ShmBufferHeader *header = nullptr;
+    char *slots = nullptr;
+    uint32_t slotCount = 0;
+    size_t maxMessage = 0;
+    size_t slotStride = 0;
+};
+
+#endif
@@ -0,0 +1,243 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <array>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "shm_buffer.h"
+#include "../Bounded_Buffer/bounded_buffer.h"
+#include "../Common/perf_counters.h"
+
+
+// Throughput of the shared memory bounded buffer with producers in separate processes (attaching
+// by name) against the same buffer between threads and the in-process BoundedBuffer, plus a crash
+// test that SIGKILLs producers at random points of their sends and checks the buffer keeps working:
+//
+//   shm_buffer_benchmark [--producers P] [--messages N] [--capacity C] [--kills K]
+//                        [--mode processes|threads|in_process|crash|all]
+//
+// Every message carries its producer and sequence number; the consumer checks each producer's
+// messages arrive in order. Throughput rows end with hardware counters for the run (producer
+// processes included) and per message
+
+const size_t MESSAGE_SIZE = 64;
+
+typedef std::chrono::steady_clock Clock;
+typedef std::array<char, MESSAGE_SIZE> Message;
+
+struct Config {
+    int producers = 4;
+    long messages = 1000000;  // per producer
+    uint32_t capacity = 1024;
+    int kills = 200;
+};
+
+
+Message makeMessage(uint32_t producer, uint64_t sequence) {
+    Message message = {};
+    memcpy(message.data(), &producer, sizeof(producer));
+    memcpy(message.data() + sizeof(producer), &sequence, sizeof(sequence));
+    return message;
+}
+
+// Check message is the next one from its producer
+bool checkOrder(const Message &message, std::vector<uint64_t> &next) {
+    uint32_t producer;
+    uint64_t sequence;
+    memcpy(&producer, message.data(), sizeof(producer));
+    memcpy(&sequence, message.data() + sizeof(producer), sizeof(sequence));
+    if (producer >= next.size() || sequence != next[producer])
+        return false;
+    next[producer]++;
+    return true;
+}
+
+// Producer side of the processes and crash modes: attach by name, send count messages (forever
+// if count < 0) and exit without running destructors, which belong to the parent
+void producerProcess(const char *name, uint32_t id, long count) {
+    ShmBuffer buffer;
+    while (!buffer.attach(name)) {
+        if (errno != EAGAIN) {
+            perror("attach");
+            _exit(1);
+        }
+    }
+    for (long i = 0; count < 0 || i < count; i++) {
+        Message message = makeMessage(id, i);
+        if (!buffer.send(message.data(), message.size()))
+            break;
+    }
+    _exit(0);
+}
+
+void printRow(const char *mode, const Config &config, double seconds, bool ordered, uint64_t recoveries,
+              const PerfSample &perf) {
+    long total = config.messages * config.producers;
+    std::cout << mode << ',' << config.producers << ',' << config.capacity << ',' << MESSAGE_SIZE << ',' << total
+              << ',' << seconds << ',' << static_cast<long>(total / seconds) << ',' << (ordered ? "yes" : "no")
+              << ',' << recoveries << perf.csv(total) << std::endl;
+}
+
+
+bool runShm(const Config &config, bool processes) {
+    ShmBuffer buffer;
+    if (!buffer.create(nullptr, config.capacity, MESSAGE_SIZE)) {
+        perror("create");
+        return false;
+    }
+
+    PerfCounters counters;
+    counters.start();
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < config.producers; p++) {
+        if (processes) {
+            if (fork() == 0)
+                producerProcess(buffer.name(), p, config.messages);
+        } else {
+            threads.emplace_back([&buffer, &config, p] {
+                for (long i = 0; i < config.messages; i++) {
+                    Message message = makeMessage(p, i);
+                    buffer.send(message.data(), message.size());
+                }
+            });
+        }
+    }
+
+    std::vector<uint64_t> next(config.producers, 0);
+    bool ordered = true;
+    Message message;
+    size_t length;
+    for (long i = 0; i < config.messages * config.producers && buffer.receive(message.data(), message.size(), length); i++)
+        ordered = checkOrder(message, next) && ordered;
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (std::thread &thread : threads)
+        thread.join();
+    while (wait(NULL) > 0);
+    PerfSample perf = counters.stop();
+    printRow(processes ? "processes" : "threads", config, seconds, ordered, buffer.recoveries(), perf);
+    return true;
+}
+
+
+void runInProcess(const Config &config) {
+    BoundedBuffer<Message> buffer(config.capacity, config.producers);
+
+    PerfCounters counters;
+    counters.start();
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < config.producers; p++) {
+        threads.emplace_back([&buffer, &config, p] {
+            for (long i = 0; i < config.messages; i++)
+                buffer.put(makeMessage(p, i));
+            buffer.producerDone();
+        });
+    }
+
+    std::vector<uint64_t> next(config.producers, 0);
+    bool ordered = true;
+    Message message;
+    while (buffer.take(message))
+        ordered = checkOrder(message, next) && ordered;
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (std::thread &thread : threads)
+        thread.join();
+    PerfSample perf = counters.stop();
+    printRow("in_process", config, seconds, ordered, 0, perf);
+}
+
+
+// Kill producers mid-stream over and over while the parent consumes. Some kills land while the
+// victim holds the mutex; each of those shows up as a recovery. Afterwards one more message must
+// still get through, and every producer's messages must have stayed in order
+bool runCrash(const Config &config) {
+    ShmBuffer buffer;
+    if (!buffer.create(nullptr, config.capacity, MESSAGE_SIZE)) {
+        perror("create");
+        return false;
+    }
+
+    std::vector<uint64_t> next(config.kills + 1, 0);
+    bool ordered = true;
+    long received = 0;
+    std::thread consumer([&] {
+        Message message;
+        size_t length;
+        while (buffer.receive(message.data(), message.size(), length)) {
+            ordered = checkOrder(message, next) && ordered;
+            received++;
+        }
+    });
+
+    srand(getpid());
+    auto start = Clock::now();
+    for (int k = 0; k < config.kills; k++) {
+        pid_t pid = fork();
+        if (pid == 0)
+            producerProcess(buffer.name(), k, -1);
+        usleep(100 + rand() % 2000);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+
+    Message last = makeMessage(config.kills, 0);
+    bool usable = buffer.send(last.data(), last.size());
+    buffer.close();
+    consumer.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    usable = usable && next[config.kills] == 1;
+
+    std::cout << "crash," << config.kills << " producers killed," << buffer.recoveries() << " recoveries,"
+              << received << " received," << (ordered ? "in order" : "OUT OF ORDER") << ','
+              << (usable ? "usable" : "STUCK") << ',' << seconds << "s" << std::endl;
+    return usable && ordered;
+}
+
+
+int main(int argc, char *argv[]) {
+    Config config;
+    std::string mode = "all";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--producers") config.producers = atoi(argv[i + 1]);
+        else if (option == "--messages") config.messages = atol(argv[i + 1]);
+        else if (option == "--capacity") config.capacity = atoi(argv[i + 1]);
+        else if (option == "--kills") config.kills = atoi(argv[i + 1]);
+        else if (option == "--mode") mode = argv[i + 1];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--producers P] [--messages N] [--capacity C] [--kills K]"
+                      << " [--mode processes|threads|in_process|crash|all]\n";
+            return 1;
+        }
+    }
+    if (config.producers < 1 || config.messages < 1 || config.capacity < 1 || config.kills < 0) {
+        std::cerr << "Need producers, messages and capacity >= 1\n";
+        return 1;
+    }
+
+    bool ok = true;
+    if (mode != "crash") {
+        std::cout << "mode,producers,capacity,message_bytes,messages,seconds,messages_per_sec,in_order,recoveries"
+                  << perfCsvHeader() << '\n';
+        if (mode == "processes" || mode == "all")
+            ok = runShm(config, true) && ok;
+        if (mode == "threads" || mode == "all")
+            ok = runShm(config, false) && ok;
+        if (mode == "in_process" || mode == "all")
+            runInProcess(config);
+    }
+    if (mode == "crash" || mode == "all")
+        ok = runCrash(config) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+#ifndef SHM_MAILBOX_H
+#define SHM_MAILBOX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+const int CACHE_LINE_SIZE = 64;
+const uint32_t SLOTS_PER_PRODUCER = 8;  // must be a power of two
+const size_t SLOT_SIZE = 256;  // bytes per slot, including the length prefix
+
+
+// Futex helpers; the words live in shared memory so the non-private futex ops are used
+inline void futexWait(std::atomic<uint32_t> *word, uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+inline void futexWake(std::atomic<uint32_t> *word, int count) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+}
+
+
+// Fixed size message slot
+struct MailboxSlot {
+    uint32_t length;
+    char data[SLOT_SIZE - sizeof(uint32_t)];
+};
+
+
+// Single-producer ring owned by one child. head is only written by the producer and tail only by
+// the consumer, each on its own cache line, so producers never touch each other's lines
+struct alignas(CACHE_LINE_SIZE) ProducerRing {
+    std::atomic<uint32_t> head;  // sequence number of the next slot to be written
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> tail;  // sequence number of the next slot to be read
+    std::atomic<uint32_t> producerWaiting;  // set while the producer sleeps on a full ring
+    alignas(CACHE_LINE_SIZE) MailboxSlot slots[SLOTS_PER_PRODUCER];
+};
+
+
+// Multi-producer mailbox: one slot ring per producer, drained by a single consumer.
+// Must be placed in memory shared by all participating processes
+class Mailbox {
+public:
+    // Number of bytes needed for a mailbox with numProducers rings
+    static size_t bytesFor(int numProducers) {
+        return sizeof(Mailbox) + static_cast<size_t>(numProducers) * sizeof(ProducerRing);
+    }
+
+    // Construct a mailbox in already allocated (and zeroed or not) shared memory
+    static Mailbox *create(void *memory, int numProducers) {
+        Mailbox *mailbox = new (memory) Mailbox();
+        mailbox->numProducers = numProducers;
+        for (int i = 0; i < numProducers; i++) {
+            ProducerRing *ring = new (&mailbox->rings()[i]) ProducerRing();
+            ring->head.store(0, std::memory_order_relaxed);
+            ring->tail.store(0, std::memory_order_relaxed);
+            ring->producerWaiting.store(0, std::memory_order_relaxed);
+        }
+        return mailbox;
+    }
+
+    int producers() const { return numProducers; }
+
+    // Producer side: copy a message into the producer's ring, sleeping only while the ring is full
+    void send(int producerId, const char *message, size_t length) {
+        ProducerRing &ring = rings()[producerId];
+        uint32_t head = ring.head.load(std::memory_order_relaxed);
+
+        // Wait for a free slot
+        uint32_t tail = ring.tail.load(std::memory_order_acquire);
+        while (head - tail == SLOTS_PER_PRODUCER) {
+            ring.producerWaiting.store(1, std::memory_order_seq_cst);
+            tail = ring.tail.load(std::memory_order_seq_cst);
+            if (head - tail == SLOTS_PER_PRODUCER)
+                futexWait(&ring.tail, tail);
+            ring.producerWaiting.store(0, std::memory_order_relaxed);
+            tail = ring.tail.load(std::memory_order_acquire);
+        }
+
+        // Write the message, then publish it by advancing head
+        MailboxSlot &slot = ring.slots[head & (SLOTS_PER_PRODUCER - 1)];
+        if (length > sizeof(slot.data))
+            length = sizeof(slot.data);
+        memcpy(slot.data, message, length);
+        slot.length = static_cast<uint32_t>(length);
+        ring.head.store(head + 1, std::memory_order_seq_cst);
+
+        // Only ring the doorbell if the consumer went to sleep
+        if (consumerSleeping.load(std::memory_order_seq_cst)) {
+            doorbell.fetch_add(1, std::memory_order_seq_cst);
+            futexWake(&doorbell, 1);
+        }
+    }
+
+    // Consumer side: hand every ready message to handler(producerId, data, length) in one pass
+    // over the rings. Returns the number of messages consumed
+    template <typename Handler>
+    int drain(Handler &&handler) {
+        int consumed = 0;
+        for (int i = 0; i < numProducers; i++) {
+            ProducerRing &ring = rings()[i];
+            uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+            uint32_t head = ring.head.load(std::memory_order_acquire);
+            if (tail == head)
+                continue;
+
+            for (; tail != head; tail++, consumed++) {
+                const MailboxSlot &slot = ring.slots[tail & (SLOTS_PER_PRODUCER - 1)];
+                handler(i, slot.data, static_cast<size_t>(slot.length));
+            }
+
+            // Free the slots and wake the producer if it is blocked on a full ring
+            ring.tail.store(tail, std::memory_order_seq_cst);
+            if (ring.producerWaiting.load(std::memory_order_seq_cst))
+                futexWake(&ring.tail, 1);
+        }
+        return consumed;
+    }
+
+    // Consumer side: like drain(), but sleeps on the doorbell while every ring is empty
+    template <typename Handler>
+    int receive(Handler &&handler) {
+        while (true) {
+            int consumed = drain(handler);
+            if (consumed > 0)
+                return consumed;
+
+            // Announce sleep, then re-check so a message published in between is not missed
+            uint32_t ticket = doorbell.load(std::memory_order_seq_cst);
+            consumerSleeping.store(1, std::memory_order_seq_cst);
+            consumed = drain(handler);
+            if (consumed == 0)
+                futexWait(&doorbell, ticket);
+            consumerSleeping.store(0, std::memory_order_relaxed);
+            if (consumed > 0)
+                return consumed;
+        }
+    }
+
+private:
+    Mailbox() : doorbell(0), consumerSleeping(0), numProducers(0) {}
+
+    ProducerRing *rings() {
+        return reinterpret_cast<ProducerRing*>(reinterpret_cast<char*>(this) + sizeof(Mailbox));
+    }
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> doorbell;  // bumped by producers to wake the consumer
+    std::atomic<uint32_t> consumerSleeping;  // set while the consumer waits on the doorbell
+    int numProducers;
+};
+
+static_assert(sizeof(Mailbox) % CACHE_LINE_SIZE == 0, "rings must start on a cache line");
+static_assert((SLOTS_PER_PRODUCER & (SLOTS_PER_PRODUCER - 1)) == 0, "slot count must be a power of two");
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef SHM_REGION_H
+#define SHM_REGION_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+
+// Options for creating or attaching a shared region
+struct RegionOptions {
+    bool hugePages = false;  // try MAP_HUGETLB first, fall back to transparent huge pages
+    bool populate = false;  // pre-fault every page so the first writes don't page fault
+    int numaNode = -1;  // bind the pages to this NUMA node, -1 == default (first touch) policy
+};
+
+
+// Shared memory region backed by memfd_create (anonymous, inherited across fork) or shm_open
+// (attachable by name). The mapping, descriptor and name are released by the destructor
+class SharedRegion {
+public:
+    SharedRegion() {}
+    ~SharedRegion() { release(); }
+
+    SharedRegion(const SharedRegion&) = delete;
+    SharedRegion &operator=(const SharedRegion&) = delete;
+
+    // Anonymous region; disappears once every process holding it has unmapped it.
+    // Returns false and leaves errno set on failure
+    bool create(size_t size, const RegionOptions &options = RegionOptions()) {
+        release();
+
+        // Hugetlb pages first, normal pages if none are reserved
+        if (options.hugePages) {
+            fd = memfd_create("concurrency-region", MFD_CLOEXEC | MFD_HUGETLB);
+            if (fd != -1 && mapFd(roundUp(size, HUGE_PAGE_SIZE), MAP_HUGETLB, options))
+                return true;
+            release();
+        }
+
+        fd = memfd_create("concurrency-region", MFD_CLOEXEC);
+        if (fd == -1)
+            return false;
+        return mapFd(size, 0, options);
+    }
+
+    // Named region, other processes can attach to it with attach(). If name is nullptr a
+    // unique name is generated. The creating object unlinks the name when it is released
+    bool createNamed(const char *name, size_t size, const RegionOptions &options = RegionOptions()) {
+        release();
+
+        if (name == nullptr) {
+            static std::atomic<int> counter(0);
+            snprintf(regionName, sizeof(regionName), "/concurrency-%d-%d", getpid(), counter++);
+        } else {
+            snprintf(regionName, sizeof(regionName), "%s", name);
+        }
+
+        fd = shm_open(regionName, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+        if (fd == -1) {
+            regionName[0] = '\0';
+            return false;
+        }
+        owner = true;
+
+        // tmpfs can't use hugetlb pages, only transparent huge pages
+        return mapFd(size, 0, options);
+    }
+
+    // Attach to a region created with createNamed(); the size is taken from the object
+    bool attach(const char *name, const RegionOptions &options = RegionOptions()) {
+        release();
+
+        fd = shm_open(name, O_RDWR | O_CLOEXEC, 0600);
+        if (fd == -1)
+            return false;
+        snprintf(regionName, sizeof(regionName), "%s", name);
+
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            release();
+            return false;
+        }
+
+        RegionOptions attachOptions = options;
+        attachOptions.hugePages = false;  // a tmpfs object can't be remapped with hugetlb pages
+        return mapFd(static_cast<size_t>(st.st_size), 0, attachOptions, false);
+    }
+
+    // Unmap, close and (if this object created the name) unlink
+    void release() {
+        if (base != nullptr)
+            munmap(base, length);
+        if (fd != -1)
+            close(fd);
+        if (owner && regionName[0] != '\0')
+            shm_unlink(regionName);
+
+        base = nullptr;
+        length = 0;
+        fd = -1;
+        owner = false;
+        regionName[0] = '\0';
+    }
+
+    void *data() const { return base; }
+    size_t size() const { return length; }
+    const char *name() const { return regionName; }
+    bool usesHugePages() const { return hugetlb; }
+
+private:
+    static size_t roundUp(size_t value, size_t multiple) {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    bool mapFd(size_t size, int extraFlags, const RegionOptions &options, bool resize = true) {
+        int savedErrno;
+        int flags = MAP_SHARED | extraFlags;
+
+        // NUMA binding has to happen before the pages are touched, so populate afterwards
+        if (options.populate && options.numaNode < 0)
+            flags |= MAP_POPULATE;
+
+        // The node mask passed to mbind is a single unsigned long
+        if (options.numaNode >= static_cast<int>(sizeof(unsigned long) * 8)) {
+            errno = EINVAL;
+            goto fail;
+        }
+
+        if (resize && ftruncate(fd, static_cast<off_t>(size)) == -1)
+            goto fail;
+
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+        if (base == MAP_FAILED) {
+            base = nullptr;
+            goto fail;
+        }
+        length = size;
+        hugetlb = (extraFlags & MAP_HUGETLB) != 0;
+
+        if (options.hugePages && !hugetlb)
+            madvise(base, length, MADV_HUGEPAGE);  // best effort, depends on the THP shmem setting
+
+        if (options.numaNode >= 0) {
+            unsigned long nodeMask = 1UL << options.numaNode;
+            if (syscall(SYS_mbind, base, length, MPOL_BIND, &nodeMask, sizeof(nodeMask) * 8, 0) == -1)
+                goto fail;
+
+            // Touch every page from here so it is allocated on the bound node. Reads fault shared
+            // pages in just the same, and leave the contents of a region that is already in use alone
+            if (options.populate) {
+                long pageSize = hugetlb ? static_cast<long>(HUGE_PAGE_SIZE) : sysconf(_SC_PAGESIZE);
+                for (size_t offset = 0; offset < length; offset += static_cast<size_t>(pageSize))
+                    (void)static_cast<volatile char*>(base)[offset];
+            }
+        }
+        return true;
+
+    fail:
+        savedErrno = errno;
+        release();
+        errno = savedErrno;
+        return false;
+    }
+
+    void *base = nullptr;
+    size_t length = 0;
+    int fd = -1;
+    bool owner = false;
+    bool hugetlb = false;
+    char regionName[64] = "";
+};
+
+#endif
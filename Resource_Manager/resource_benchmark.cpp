@@ -0,0 +1,171 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "resource_manager.h"
+#include "../Common/histogram.h"
+
+
+// Throughput of the resource managers on a closed-loop workload: every worker repeatedly picks a
+// random set of SET_SIZE resources out of its claim (CLAIM_SIZE random resources out of N),
+// acquires the set, holds it briefly and releases it. The claim only matters to the Banker's
+// manager, the others see the same stream of requests. Results are printed as CSV
+
+const int NUM_RESOURCES = 10000;
+const int NUM_WORKERS = 8;
+const int SET_SIZE = 4;
+const int CLAIM_SIZE = 32;
+const int RUN_SECONDS = 2;
+const int HOLD_US = 0;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Config {
+    int resources = NUM_RESOURCES;
+    int workers = NUM_WORKERS;
+    int setSize = SET_SIZE;
+    int claimSize = CLAIM_SIZE;
+    int seconds = RUN_SECONDS;
+    int holdUs = HOLD_US;
+};
+
+std::atomic<bool> stopFlag(false);
+
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// Claim of every worker, drawn from the same seed so all managers see the same workload
+std::vector<ResourceSet> makeClaims(const Config &config) {
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<int> pick(0, config.resources - 1);
+    std::vector<ResourceSet> claims(config.workers);
+    for (ResourceSet &claim : claims) {
+        while (static_cast<int>(claim.size()) < config.claimSize) {
+            claim.emplace_back(pick(gen));
+            normalize(claim);
+        }
+    }
+    return claims;
+}
+
+
+template <typename Manager>
+void worker(int id, const Config &config, Manager &manager, int client, const ResourceSet &claim,
+            long &requests, LatencyHistogram &histogram) {
+    std::mt19937 gen(id);
+    ResourceSet pool = claim;
+    ResourceSet set;
+
+    while (!stopFlag) {
+        // Partial Fisher-Yates: the first setSize entries of pool become the request
+        for (int i = 0; i < config.setSize; i++)
+            std::swap(pool[i], pool[i + gen() % (pool.size() - i)]);
+        set.assign(pool.begin(), pool.begin() + config.setSize);
+        normalize(set);
+
+        uint64_t start = nowNs();
+        manager.acquire(client, set);
+        histogram.record(nowNs() - start);
+
+        if (config.holdUs > 0) {
+            auto end = Clock::now() + std::chrono::microseconds(config.holdUs);
+            while (Clock::now() < end)
+                cpuRelax();
+        }
+        manager.release(client, set);
+        requests++;
+    }
+}
+
+
+// Run one manager for config.seconds and print its CSV line
+template <typename Manager>
+void runMode(const char *name, const Config &config, Manager &manager, const std::vector<int> &clients,
+             const std::vector<ResourceSet> &claims) {
+    std::vector<long> requests(config.workers, 0);
+    std::vector<LatencyHistogram> histograms(config.workers);
+    std::vector<std::thread> threads;
+
+    stopFlag = false;
+    auto start = Clock::now();
+    for (int i = 0; i < config.workers; i++)
+        threads.emplace_back([&, i] { worker(i, config, manager, clients[i], claims[i], requests[i], histograms[i]); });
+
+    std::this_thread::sleep_for(std::chrono::seconds(config.seconds));
+    stopFlag = true;
+    for (std::thread &thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    LatencyHistogram histogram;
+    long total = 0;
+    for (int i = 0; i < config.workers; i++) {
+        histogram.merge(histograms[i]);
+        total += requests[i];
+    }
+    auto minmax = std::minmax_element(requests.begin(), requests.end());
+
+    std::cout << name << ',' << config.resources << ',' << config.setSize << ',' << config.workers << ','
+              << total << ',' << static_cast<long>(total / seconds) << ',' << histogram.percentile(0.50) << ','
+              << histogram.percentile(0.99) << ',' << histogram.max() << ',' << *minmax.first << ','
+              << *minmax.second << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+    Config config;
+    std::string mode = "all";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--resources") config.resources = value;
+        else if (option == "--workers") config.workers = value;
+        else if (option == "--set-size") config.setSize = value;
+        else if (option == "--claim-size") config.claimSize = value;
+        else if (option == "--seconds") config.seconds = value;
+        else if (option == "--hold-us") config.holdUs = value;
+        else if (option == "--mode") mode = argv[i + 1];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--resources N] [--workers N] [--set-size K] [--claim-size C]"
+                      << " [--seconds S] [--hold-us U] [--mode ordered|reservation|bankers|all]\n";
+            return 1;
+        }
+    }
+
+    if (config.workers < 1 || config.setSize < 1 || config.claimSize < config.setSize ||
+        config.claimSize > config.resources) {
+        std::cerr << "Need 1 <= set size <= claim size <= resources\n";
+        return 1;
+    }
+
+    std::vector<ResourceSet> claims = makeClaims(config);
+    std::vector<int> noClients(config.workers, 0);
+
+    std::cout << "mode,resources,set_size,workers,requests,requests_per_s,p50_acquire_ns,p99_acquire_ns,"
+                 "max_acquire_ns,min_per_worker,max_per_worker\n";
+
+    if (mode == "ordered" || mode == "all") {
+        OrderedLockManager manager(config.resources);
+        runMode("ordered", config, manager, noClients, claims);
+    }
+    if (mode == "reservation" || mode == "all") {
+        ReservationManager manager(config.resources);
+        runMode("reservation", config, manager, noClients, claims);
+    }
+    if (mode == "bankers" || mode == "all") {
+        BankersManager manager(config.resources);
+        std::vector<int> clients;
+        for (const ResourceSet &claim : claims)
+            clients.emplace_back(manager.registerClient(claim));
+        runMode("bankers", config, manager, clients, claims);
+        std::cerr << "bankers: " << manager.slowChecks() << " grants needed the full safety check\n";
+    }
+}
@@ -0,0 +1,358 @@
+#ifndef RESOURCE_MANAGER_H
+#define RESOURCE_MANAGER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../Common/cpu_relax.h"
+
+
+// Generalisation of the dining table: instead of diner i needing chopsticks i and i + 1, a job
+// needs an arbitrary set of resources out of N and must hold all of them at once. Every manager
+// acquires a whole set or nothing, so no job ever holds part of its set while blocking another.
+// All managers share the acquire(client, set) / release(client, set) interface, where a set is a
+// sorted list of distinct resource indices (see normalize())
+
+typedef std::vector<int> ResourceSet;
+
+// Sort and de-duplicate a request so it can be passed to any manager
+inline void normalize(ResourceSet &set) {
+    std::sort(set.begin(), set.end());
+    set.erase(std::unique(set.begin(), set.end()), set.end());
+}
+
+
+// One mutex per resource, taken in ascending index order. Every job agrees on the order, so no
+// cycle of waiters can form (the lockInOrder() rule of the dining table, for K locks). Fairness is
+// whatever std::mutex gives
+class OrderedLockManager {
+public:
+    explicit OrderedLockManager(int resources) : locks(resources) {}
+
+    bool acquire(int, const ResourceSet &set) {
+        for (int resource : set)
+            locks[resource].lock();
+        return true;
+    }
+
+    bool release(int, const ResourceSet &set) {
+        for (auto it = set.rbegin(); it != set.rend(); ++it)
+            locks[*it].unlock();
+        return true;
+    }
+
+private:
+    std::vector<std::mutex> locks;
+};
+
+
+// Two-phase reservation over an atomic bitset. Phase one claims the set's bits word by word (one
+// CAS per 64 resources touched); if any bit is taken the words claimed so far are rolled back and
+// the job retries later, so a job never waits while holding anything. Phase two is the commit:
+// once every word is claimed the job owns the whole set.
+//
+// Retrying alone can starve a job whose set keeps overlapping with shorter ones, so requests age:
+// after agingThreshold failed attempts a job stakes its ticket on each of its resources. Younger
+// jobs (higher tickets) back off from a staked resource, so the oldest aged job only waits for
+// the current holders to leave
+class ReservationManager {
+public:
+    static const int DEFAULT_AGING_THRESHOLD = 32;
+
+    explicit ReservationManager(int resources, int agingThreshold = DEFAULT_AGING_THRESHOLD)
+        : numWords((resources + 63) / 64), threshold(agingThreshold),
+          bits(new std::atomic<uint64_t>[numWords]), stakes(new std::atomic<uint64_t>[resources]) {
+        for (int i = 0; i < numWords; i++)
+            bits[i].store(0, std::memory_order_relaxed);
+        for (int i = 0; i < resources; i++)
+            stakes[i].store(NO_STAKE, std::memory_order_relaxed);
+    }
+
+    bool acquire(int, const ResourceSet &set) {
+        uint64_t ticket = nextTicket.fetch_add(1, std::memory_order_relaxed);
+        bool aged = false;
+
+        for (int attempt = 1; !tryReserve(set, ticket); attempt++) {
+            if (attempt >= threshold) {
+                // Re-stake every round: an older job may have overwritten and then withdrawn our stake
+                aged = true;
+                stake(set, ticket);
+            }
+            backOff(attempt);
+        }
+
+        if (aged)
+            withdraw(set, ticket);
+        return true;
+    }
+
+    bool release(int, const ResourceSet &set) {
+        for (size_t i = 0; i < set.size();) {
+            int word = set[i] / 64;
+            uint64_t mask = wordMask(set, i);
+            bits[word].fetch_and(~mask, std::memory_order_release);
+        }
+        return true;
+    }
+
+private:
+    static const uint64_t NO_STAKE = UINT64_MAX;
+
+    // Bits of set[i..] that fall in the same word as set[i]; advances i past them
+    static uint64_t wordMask(const ResourceSet &set, size_t &i) {
+        int word = set[i] / 64;
+        uint64_t mask = 0;
+        for (; i < set.size() && set[i] / 64 == word; i++)
+            mask |= uint64_t(1) << (set[i] % 64);
+        return mask;
+    }
+
+    bool stakedByOlder(const ResourceSet &set, size_t from, size_t to, uint64_t ticket) const {
+        for (size_t j = from; j < to; j++)
+            if (stakes[set[j]].load(std::memory_order_relaxed) < ticket)
+                return true;
+        return false;
+    }
+
+    bool tryReserve(const ResourceSet &set, uint64_t ticket) {
+        size_t i = 0;
+        while (i < set.size()) {
+            size_t first = i;
+            int word = set[i] / 64;
+            uint64_t mask = wordMask(set, i);
+
+            bool claimed = false;
+            if (!stakedByOlder(set, first, i, ticket)) {
+                uint64_t current = bits[word].load(std::memory_order_relaxed);
+                while (!(current & mask)) {
+                    if (bits[word].compare_exchange_weak(current, current | mask, std::memory_order_acquire,
+                                                         std::memory_order_relaxed)) {
+                        claimed = true;
+                        break;
+                    }
+                }
+            }
+
+            if (!claimed) {
+                // Roll back the words claimed before this one
+                for (size_t j = 0; j < first;) {
+                    int claimedWord = set[j] / 64;
+                    uint64_t claimedMask = wordMask(set, j);
+                    bits[claimedWord].fetch_and(~claimedMask, std::memory_order_relaxed);
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Lower the stake on each resource to our ticket unless an older job already holds it
+    void stake(const ResourceSet &set, uint64_t ticket) {
+        for (int resource : set) {
+            uint64_t current = stakes[resource].load(std::memory_order_relaxed);
+            while (current > ticket &&
+                   !stakes[resource].compare_exchange_weak(current, ticket, std::memory_order_relaxed))
+                ;
+        }
+    }
+
+    void withdraw(const ResourceSet &set, uint64_t ticket) {
+        for (int resource : set) {
+            uint64_t expected = ticket;
+            stakes[resource].compare_exchange_strong(expected, NO_STAKE, std::memory_order_relaxed);
+        }
+    }
+
+    // Spin briefly (holders are usually about to leave), then give the CPU away
+    static void backOff(int attempt) {
+        if (attempt < 8) {
+            for (int i = 0; i < (1 << attempt); i++)
+                cpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    int numWords;
+    int threshold;
+    std::unique_ptr<std::atomic<uint64_t>[]> bits;
+    std::unique_ptr<std::atomic<uint64_t>[]> stakes;  // oldest aged ticket waiting for each resource
+    alignas(64) std::atomic<uint64_t> nextTicket{0};
+};
+
+
+// Banker's algorithm for bounded-claim workloads. Each client declares up front the resources it
+// may ever hold at once (its claim), and may then acquire them in any number of steps, holding
+// some while asking for more. A request is granted only if the resulting state is safe: some
+// order exists in which every client holding resources can obtain the rest of its claim and
+// finish. Resources have a capacity (units); a request takes one unit of each listed resource.
+//
+// The safety check is incremental. If, after the grant, the requester's own remaining need fits
+// in what is available, the state is safe: the requester can finish and return everything,
+// leaving more available than before the (safe) previous state. Only otherwise does the full
+// check run, and then only over clients that hold something, since a client holding nothing
+// releases nothing and can always run last
+class BankersManager {
+public:
+    explicit BankersManager(int resources, int units = 1)
+        : available(resources, units), capacity(resources, units), credit(resources, 0) {}
+
+    // Declare a client's claim. Returns its id, or -1 if the claim can never be satisfied
+    int registerClient(ResourceSet claim) {
+        normalize(claim);
+        for (int resource : claim)
+            if (resource < 0 || resource >= static_cast<int>(capacity.size()) || capacity[resource] < 1)
+                return -1;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Client client;
+        client.claim = claim;
+        client.held.assign(claim.size(), 0);
+        clients.push_back(std::move(client));
+        return static_cast<int>(clients.size()) - 1;
+    }
+
+    // Block until the grant is safe. Returns false if the set is outside the client's claim or
+    // already (partly) held by it
+    bool acquire(int id, const ResourceSet &set) {
+        std::unique_lock<std::mutex> lock(mutex);
+        Client &client = clients[id];
+        for (int resource : set) {
+            int slot = client.slotOf(resource);
+            if (slot < 0 || client.held[slot])
+                return false;
+        }
+
+        waiters++;
+        changed.wait(lock, [&] { return tryGrant(client, set); });
+        waiters--;
+        return true;
+    }
+
+    bool release(int id, const ResourceSet &set) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Client &client = clients[id];
+            for (int resource : set) {
+                int slot = client.slotOf(resource);
+                if (slot < 0 || !client.held[slot])
+                    return false;
+            }
+            for (int resource : set) {
+                client.held[client.slotOf(resource)] = 0;
+                client.heldCount--;
+                available[resource]++;
+            }
+            if (waiters == 0)
+                return true;
+        }
+        changed.notify_all();
+        return true;
+    }
+
+    // Grants that needed the full safety check, for tuning claim sizes
+    long slowChecks() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return fullChecks;
+    }
+
+private:
+    struct Client {
+        ResourceSet claim;
+        std::vector<char> held;  // parallel to claim
+        int heldCount = 0;
+
+        int slotOf(int resource) const {
+            auto it = std::lower_bound(claim.begin(), claim.end(), resource);
+            return (it != claim.end() && *it == resource) ? static_cast<int>(it - claim.begin()) : -1;
+        }
+    };
+
+    // Grant the set if it is available and leaves the state safe; otherwise leave everything as is
+    bool tryGrant(Client &client, const ResourceSet &set) {
+        for (int resource : set)
+            if (available[resource] == 0)
+                return false;
+
+        for (int resource : set) {
+            client.held[client.slotOf(resource)] = 1;
+            client.heldCount++;
+            available[resource]--;
+        }
+
+        if (needFits(client) || isSafe())
+            return true;
+
+        for (int resource : set) {
+            client.held[client.slotOf(resource)] = 0;
+            client.heldCount--;
+            available[resource]++;
+        }
+        return false;
+    }
+
+    // Could the client get the rest of its claim right now (counting resources already credited
+    // back by clients the safety check has finished)?
+    bool needFits(const Client &client) const {
+        for (size_t i = 0; i < client.claim.size(); i++)
+            if (!client.held[i] && available[client.claim[i]] + credit[client.claim[i]] < 1)
+                return false;
+        return true;
+    }
+
+    bool isSafe() {
+        fullChecks++;
+        pending.clear();
+        for (Client &client : clients)
+            if (client.heldCount > 0)
+                pending.push_back(&client);
+
+        // Finish any client whose need fits, credit back its holdings, repeat until stuck
+        bool progress = true;
+        while (!pending.empty() && progress) {
+            progress = false;
+            for (size_t i = 0; i < pending.size();) {
+                if (needFits(*pending[i])) {
+                    const Client &done = *pending[i];
+                    for (size_t j = 0; j < done.claim.size(); j++) {
+                        if (done.held[j]) {
+                            credit[done.claim[j]]++;
+                            credited.push_back(done.claim[j]);
+                        }
+                    }
+                    pending[i] = pending.back();
+                    pending.pop_back();
+                    progress = true;
+                } else {
+                    i++;
+                }
+            }
+        }
+
+        for (int resource : credited)
+            credit[resource] = 0;
+        credited.clear();
+        return pending.empty();
+    }
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<int> available;
+    std::vector<int> capacity;
+    std::deque<Client> clients;  // deque: references stay valid while clients register
+    int waiters = 0;
+    long fullChecks = 0;
+
+    // Scratch space for isSafe(), kept to avoid allocating on every check
+    std::vector<int> credit;  // units returned by finished clients, dense but mostly zero
+    std::vector<int> credited;  // resources with a non-zero credit
+    std::vector<Client*> pending;
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "rr_checkpoints.h"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include "../Common/trace.h"
+
+
+void CheckpointedRr::run() {
+    TRACE_SCOPE("checkpointed_rr");
+    sequence.clear();
+    saved.clear();
+    simulate(Checkpoint{0, 0, 0, 0, -2, {}}, OldRun());
+}
+
+
+bool CheckpointedRr::set_burst(size_t process, int64_t burst) {
+    if (process >= workload.size() || burst <= 0)
+        return false;
+
+    TRACE_SCOPE("what_if_burst");
+    workload.burst()[process] = burst;
+    resume(workload.start()[process], process);  // nothing depends on a burst before its first slice
+    return true;
+}
+
+
+bool CheckpointedRr::set_arrival(size_t process, int64_t arrival) {
+    size_t n = workload.size();
+    int64_t *arrivals = workload.arrival();
+    if (process >= n || arrival < 0 || (process > 0 && arrival < arrivals[process - 1]) ||
+        (process + 1 < n && arrival > arrivals[process + 1]))
+        return false;
+
+    TRACE_SCOPE("what_if_arrival");
+    int64_t earliest = std::min(arrival, arrivals[process]);
+    arrivals[process] = arrival;
+    resume(earliest, process);
+    return true;
+}
+
+
+// Restart from the last checkpoint at or before time. Checkpoints are taken before anything happens
+// at their time, so in every checkpoint kept, changed hasn't run yet: where it is queued, its
+// remaining burst is simply replaced by its current burst
+void CheckpointedRr::resume(int64_t time, size_t changed) {
+    auto by_time = [](const Checkpoint &checkpoint, int64_t t) { return checkpoint.time < t; };
+    auto after = std::upper_bound(saved.begin(), saved.end(), time,
+                                  [](int64_t t, const Checkpoint &checkpoint) { return t < checkpoint.time; });
+    size_t index = std::max<ptrdiff_t>(after - saved.begin() - 1, 0);
+
+    auto arrived = std::lower_bound(saved.begin(), saved.end(), workload.arrival()[changed], by_time);
+    for (auto checkpoint = arrived; checkpoint <= saved.begin() + index; checkpoint++)
+        for (std::pair<int, int64_t> &entry : checkpoint->queue)
+            if (static_cast<size_t>(entry.first) == changed)
+                entry.second = workload.burst()[changed];
+
+    Checkpoint state = saved[index];
+
+    OldRun old;
+    old.changed = changed;
+    old.checkpoints.assign(std::make_move_iterator(saved.begin() + index + 1), std::make_move_iterator(saved.end()));
+    saved.resize(index);
+    size_t kept = std::min<uint64_t>(state.seq_count, sequence.size());
+    old.seq.assign(sequence.begin() + kept, sequence.end());
+    old.seq_start = state.seq_count;
+    old.seq_total = seq_total;
+    sequence.resize(kept);
+
+    simulate(std::move(state), std::move(old));
+}
+
+
+void CheckpointedRr::simulate(Checkpoint state, OldRun old) {
+    size_t n = workload.size();
+    const int64_t *arrival = workload.arrival();
+    const int64_t *burst = workload.burst();
+    int64_t *remaining = workload.remaining();
+    int64_t *start = workload.start();
+    int64_t *finish = workload.finish();
+    int *ready = workload.ready();  // circular; every process is queued at most once
+
+    size_t head = 0, queued = 0;
+    for (const std::pair<int, int64_t> &entry : state.queue) {
+        ready[queued++] = entry.first;
+        remaining[entry.first] = entry.second;
+    }
+
+    int64_t current_time = state.time;
+    size_t next_arrival = state.next_arrival;
+    size_t done = state.done;
+    uint64_t seq_count = state.seq_count;
+    int last = state.last;
+    int64_t next_checkpoint = current_time;
+    size_t next_old = 0;
+    dispatches = 0;
+
+    auto push_arrival = [&]() {
+        size_t p = next_arrival++;
+        remaining[p] = burst[p];
+        size_t tail = head + queued;
+        ready[tail >= n ? tail - n : tail] = p;
+        queued++;
+    };
+    auto push = [&](int process) {
+        size_t tail = head + queued;
+        ready[tail >= n ? tail - n : tail] = process;
+        queued++;
+    };
+    auto append = [&](int process) {
+        if (process == last)
+            return;
+        if (seq_count < static_cast<uint64_t>(max_seq_len))
+            sequence.emplace_back(process);
+        seq_count++;
+        last = process;
+    };
+
+    while (done < n) {
+        if (current_time >= next_checkpoint) {
+            Checkpoint checkpoint{current_time, next_arrival, done, seq_count, last, {}};
+            checkpoint.queue.reserve(queued);
+            for (size_t i = 0, j = head; i < queued; i++, j = (j + 1 == n) ? 0 : j + 1)
+                checkpoint.queue.emplace_back(ready[j], remaining[ready[j]]);
+
+            while (next_old < old.checkpoints.size() && old.checkpoints[next_old].time < current_time)
+                next_old++;
+            if (next_old < old.checkpoints.size() && next_arrival > old.changed &&
+                converge(checkpoint, next_old, old))
+                return;
+
+            saved.emplace_back(std::move(checkpoint));
+            next_checkpoint = (current_time / interval + 1) * interval;
+        }
+
+        // From here on, the loop of simulate_rr (workload_store.cpp)
+        if (queued == 0) {
+            if (arrival[next_arrival] > current_time) {
+                if (last != -2)
+                    append(-1);
+                current_time = arrival[next_arrival];
+            }
+            while (next_arrival < n && arrival[next_arrival] <= current_time)
+                push_arrival();
+        }
+
+        int curr_process = ready[head];
+        head = (head + 1 == n) ? 0 : head + 1;
+        queued--;
+        if (remaining[curr_process] == burst[curr_process])  // first slice; start may still hold the old run's
+            start[curr_process] = current_time;
+        append(curr_process);
+        dispatches++;
+
+        int64_t update_time = std::min(remaining[curr_process], quantum);
+        if (queued == 0) {
+            int64_t limit = remaining[curr_process];
+            if (next_arrival < n)
+                limit = quantum * ((arrival[next_arrival] - current_time) / quantum + 1);
+            update_time = std::min(remaining[curr_process], limit);
+        }
+        remaining[curr_process] -= update_time;
+        current_time += update_time;
+
+        while (next_arrival < n && arrival[next_arrival] < current_time)
+            push_arrival();
+
+        if (remaining[curr_process] > 0) {
+            push(curr_process);
+        } else {
+            finish[curr_process] = current_time;
+            done++;
+        }
+    }
+
+    seq_total = seq_count;
+}
+
+
+// The resumed run has reached the state of an old checkpoint, so everything the old run did from
+// there on still holds. Its seq entries shift by the difference in seq length; that only works if
+// max_seq_len didn't cut off entries the new seq now has room for, otherwise keep simulating
+bool CheckpointedRr::converge(const Checkpoint &now, size_t index, OldRun &old) {
+    const Checkpoint &match = old.checkpoints[index];
+    if (!match.same_state(now))
+        return false;
+
+    uint64_t limit = static_cast<uint64_t>(max_seq_len);
+    if (now.seq_count < limit) {
+        uint64_t needed = std::min(match.seq_count + (limit - now.seq_count), old.seq_total);
+        if (needed > old.seq_start + old.seq.size())
+            return false;
+        for (uint64_t i = match.seq_count; i < needed; i++)
+            sequence.emplace_back(old.seq[i - old.seq_start]);
+    }
+
+    int64_t shift = static_cast<int64_t>(now.seq_count) - static_cast<int64_t>(match.seq_count);
+    for (size_t i = index; i < old.checkpoints.size(); i++) {
+        old.checkpoints[i].seq_count += shift;
+        saved.emplace_back(std::move(old.checkpoints[i]));
+    }
+    seq_total = old.seq_total + shift;
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef RR_CHECKPOINTS_H
+#define RR_CHECKPOINTS_H
+
+#include "workload_store.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+// simulate_rr with periodic checkpoints, for what-if queries on large workloads. A checkpoint is
+// everything the loop needs to carry on: the time, the next arrival, the seq position and the ready
+// queue with each queued process's remaining burst. Every other process either hasn't arrived (its
+// remaining burst is its burst) or has finished, so that is the whole state.
+//
+// Changing one process's burst or arrival resumes from the last checkpoint before the change could
+// matter. The resumed run compares itself with the old checkpoints as it goes; once it reaches one
+// with an identical state, usually at the end of the busy period the change fell in, the rest of the
+// old run still holds and is reused, seq included. The start and finish columns of the workload are
+// kept up to date, so the store always reflects the current parameters
+class CheckpointedRr {
+public:
+    CheckpointedRr(WorkloadStore &workload, int64_t quantum, int64_t max_seq_len, int64_t interval)
+        : workload(workload), quantum(quantum), max_seq_len(max_seq_len), interval(std::max<int64_t>(interval, 1)) {}
+
+    // Simulate the whole workload from time 0
+    void run();
+
+    // Change one process and bring the results up to date. A new arrival must keep the workload
+    // sorted; returns false (and changes nothing) if it doesn't or the burst isn't positive
+    bool set_burst(size_t process, int64_t burst);
+    bool set_arrival(size_t process, int64_t arrival);
+
+    const std::vector<int> &seq() const { return sequence; }
+    size_t checkpoints() const { return saved.size(); }
+    uint64_t last_dispatches() const { return dispatches; }  // slices simulated by the last call
+
+private:
+    struct Checkpoint {
+        int64_t time;
+        size_t next_arrival;
+        size_t done;
+        uint64_t seq_count;  // entries seq would have without max_seq_len
+        int last;  // last entry of seq, -2 while it is empty
+        std::vector<std::pair<int, int64_t>> queue;  // (process, remaining burst), front first
+
+        bool same_state(const Checkpoint &other) const {
+            return time == other.time && next_arrival == other.next_arrival && done == other.done &&
+                   last == other.last && queue == other.queue;
+        }
+    };
+
+    // What a resumed run may converge back to, once the changed process has arrived in it
+    struct OldRun {
+        size_t changed = 0;
+        std::vector<Checkpoint> checkpoints;  // those after the resume point
+        std::vector<int> seq;  // seq entries from seq_start on, as far as max_seq_len kept them
+        uint64_t seq_start = 0;
+        uint64_t seq_total = 0;
+    };
+
+    void resume(int64_t time, size_t changed);
+    void simulate(Checkpoint state, OldRun old);
+    bool converge(const Checkpoint &now, size_t index, OldRun &old);
+
+    WorkloadStore &workload;
+    int64_t quantum;
+    int64_t max_seq_len;
+    int64_t interval;
+
+    std::vector<int> sequence;
+    std::vector<Checkpoint> saved;  // by time; the first is the start of the run
+    uint64_t seq_total = 0;  // length seq would have without max_seq_len
+    uint64_t dispatches = 0;
+};
+
+#endif
@@ -2,9 +2,11 @@
 #include <queue>
 #include <iostream>
 #include <limits>
+#include "../Common/trace.h"
 
 
 void simulate_rr(int64_t quantum, int64_t max_seq_len, std::vector<Process> & processes, std::vector<int> & seq) {
+    TRACE_SCOPE("simulate_rr");
     seq.clear();
 
     std::queue<int> ready_queue;
@@ -32,6 +34,7 @@ void simulate_rr(int64_t quantum, int64_t max_seq_len, std::vector<Process> & pr
         }
         else {
             int curr_process = ready_queue.front();  // index of process being executed
+            TRACE_INSTANT("dispatch", curr_process);
 
             // Set start_time if process's first time being executed
             if (processes[curr_process].start_time == -1)
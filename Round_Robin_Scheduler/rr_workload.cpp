@@ -0,0 +1,122 @@
+#include "workload_store.h"
+#include "rr_checkpoints.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+
+// Runs simulate_rr over a workload file and reports load, simulation and metric times:
+//
+//   rr_workload [--quantum Q] [--max-seq-len L] [--what-if N] workload.txt
+//   rr_workload --generate N workload.txt     (N processes, Poisson arrivals, exponential bursts)
+//
+// --what-if N then times N random burst changes answered from checkpoints (rr_checkpoints.h)
+
+typedef std::chrono::steady_clock Clock;
+
+
+double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+
+int generate(long n, const char *path) {
+    FILE *out = fopen(path, "w");
+    if (out == nullptr) {
+        perror(path);
+        return 1;
+    }
+
+    std::mt19937_64 gen(1);
+    std::exponential_distribution<double> gap(1.0 / 100);
+    std::exponential_distribution<double> burst(1.0 / 90);
+    double time = 0;
+    for (long i = 0; i < n; i++) {
+        time += gap(gen);
+        fprintf(out, "%lld %lld\n", static_cast<long long>(time), static_cast<long long>(burst(gen)) + 1);
+    }
+    fclose(out);
+    return 0;
+}
+
+
+int main(int argc, char *argv[]) {
+    int64_t quantum = 10;
+    int64_t max_seq_len = 1000;
+    long what_ifs = 0;
+    const char *path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--generate" && i + 2 < argc)
+            return generate(atol(argv[i + 1]), argv[i + 2]);
+        if (option == "--quantum" && i + 1 < argc)
+            quantum = atol(argv[++i]);
+        else if (option == "--max-seq-len" && i + 1 < argc)
+            max_seq_len = atol(argv[++i]);
+        else if (option == "--what-if" && i + 1 < argc)
+            what_ifs = atol(argv[++i]);
+        else if (path == nullptr && option[0] != '-')
+            path = argv[i];
+        else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (path == nullptr || quantum < 1) {
+        std::cerr << "Usage: " << argv[0] << " [--quantum Q] [--max-seq-len L] [--what-if N] workload.txt\n"
+                  << "       " << argv[0] << " --generate N workload.txt\n";
+        return 1;
+    }
+
+    WorkloadStore workload;
+    auto start = Clock::now();
+    if (!load_workload(path, workload))
+        return 1;
+    double load_ms = elapsed_ms(start);
+
+    std::vector<int> seq;
+    start = Clock::now();
+    simulate_rr(quantum, max_seq_len, workload, seq);
+    double simulate_ms = elapsed_ms(start);
+
+    start = Clock::now();
+    WorkloadMetrics metrics = compute_metrics(workload);
+    double metrics_ms = elapsed_ms(start);
+
+    std::cout << workload.size() << " processes: load " << load_ms << " ms, simulate " << simulate_ms
+              << " ms, metrics " << metrics_ms << " ms\n"
+              << "turnaround mean " << metrics.mean_turnaround << " max " << metrics.max_turnaround << '\n'
+              << "waiting    mean " << metrics.mean_waiting << " max " << metrics.max_waiting << '\n'
+              << "response   mean " << metrics.mean_response << " max " << metrics.max_response << '\n';
+
+    if (what_ifs <= 0 || workload.size() == 0)
+        return 0;
+
+    CheckpointedRr checkpointed(workload, quantum, max_seq_len, quantum * 1000);
+    start = Clock::now();
+    checkpointed.run();
+    std::cout << "checkpointed run " << elapsed_ms(start) << " ms, " << checkpointed.checkpoints()
+              << " checkpoints\n";
+
+    std::mt19937_64 gen(2);
+    double total_ms = 0, max_ms = 0;
+    uint64_t slices = 0;
+    for (long i = 0; i < what_ifs; i++) {
+        size_t process = gen() % workload.size();
+        int64_t burst = 1 + gen() % (4 * workload.burst()[process] + 1);
+        start = Clock::now();
+        checkpointed.set_burst(process, burst);
+        double ms = elapsed_ms(start);
+        total_ms += ms;
+        max_ms = std::max(max_ms, ms);
+        slices += checkpointed.last_dispatches();
+    }
+    std::cout << "what-if: mean " << total_ms / what_ifs << " ms, max " << max_ms << " ms, "
+              << slices / what_ifs << " slices re-simulated on average\n";
+}
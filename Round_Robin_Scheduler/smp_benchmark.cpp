@@ -0,0 +1,133 @@
+#include "smp_scheduler.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "../Common/histogram.h"
+
+
+// Sizes an SMP host: generates a random workload and runs it through simulate_smp once per
+// load-balancing policy, printing one CSV row each:
+//
+//   smp_benchmark [--cores P] [--processes N] [--quantum Q] [--burst B] [--load L] [--placement rr|least]
+//                 [--balance-interval T] [--migration-cost M] [--policy none|steal|balance|both|all]
+//
+// Bursts are exponential with mean B and arrivals are Poisson, paced so the offered load is L times
+// the capacity of P cores
+
+typedef std::chrono::steady_clock Clock;
+
+struct Workload {
+    int cores = 8;
+    long processes = 100000;
+    int64_t quantum = 10;
+    double burst = 100;
+    double load = 0.9;
+};
+
+
+std::vector<Process> make_processes(const Workload &workload) {
+    std::mt19937_64 gen(1);
+    std::exponential_distribution<double> burst(1.0 / workload.burst);
+    std::exponential_distribution<double> gap(workload.cores * workload.load / workload.burst);
+
+    std::vector<Process> processes(workload.processes);
+    double time = 0;
+    for (Process &process : processes) {
+        time += gap(gen);
+        process.arrival_time = static_cast<int64_t>(time);
+        process.burst = std::max<int64_t>(1, static_cast<int64_t>(burst(gen)));
+    }
+    return processes;
+}
+
+
+void run_policy(const std::string &name, const Workload &workload, SmpConfig config,
+                const std::vector<Process> &input) {
+    std::vector<Process> processes = input;
+    std::vector<std::vector<int>> seqs;
+    SmpStats stats;
+
+    auto start = Clock::now();
+    simulate_smp(config, processes, seqs, stats);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    LatencyHistogram turnaround;
+    for (const Process &process : processes)
+        turnaround.record(process.finish_time - process.arrival_time);
+
+    int64_t migrations = 0;
+    for (int64_t m : stats.migrations)
+        migrations += m;
+    auto busy = std::minmax_element(stats.busy_time.begin(), stats.busy_time.end());
+
+    std::cout << name << ',' << (config.placement == Placement::ROUND_ROBIN ? "rr" : "least") << ','
+              << workload.cores << ',' << workload.processes << ',' << workload.quantum << ','
+              << stats.end_time - stats.start_time << ',' << stats.utilisation() << ',' << migrations << ','
+              << stats.migration_overhead << ',' << turnaround.mean() << ',' << turnaround.percentile(0.99) << ','
+              << turnaround.max() << ',' << *busy.first << ',' << *busy.second << ',' << ms << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+    Workload workload;
+    SmpConfig config;
+    std::string policy = "all";
+    int64_t balance_interval = 1000;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--cores") workload.cores = atoi(argv[i + 1]);
+        else if (option == "--processes") workload.processes = atol(argv[i + 1]);
+        else if (option == "--quantum") workload.quantum = atol(argv[i + 1]);
+        else if (option == "--burst") workload.burst = atof(argv[i + 1]);
+        else if (option == "--load") workload.load = atof(argv[i + 1]);
+        else if (option == "--balance-interval") balance_interval = atol(argv[i + 1]);
+        else if (option == "--migration-cost") config.migration_cost = atol(argv[i + 1]);
+        else if (option == "--policy") policy = argv[i + 1];
+        else if (option == "--placement") {
+            config.placement = std::string(argv[i + 1]) == "rr" ? Placement::ROUND_ROBIN : Placement::LEAST_LOADED;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--cores P] [--processes N] [--quantum Q] [--burst B] [--load L]"
+                      << " [--placement rr|least] [--balance-interval T] [--migration-cost M]"
+                      << " [--policy none|steal|balance|both|all]\n";
+            return 1;
+        }
+    }
+
+    if (workload.cores < 1 || workload.processes < 1 || workload.quantum < 1 || workload.burst < 1 ||
+        workload.load <= 0 || balance_interval < 1) {
+        std::cerr << "Need at least one core, one process, quantum >= 1, burst >= 1, load > 0, interval >= 1\n";
+        return 1;
+    }
+
+    config.cores = workload.cores;
+    config.quantum = workload.quantum;
+    config.max_seq_len = 1000;
+    std::vector<Process> processes = make_processes(workload);
+
+    std::cout << "policy,placement,cores,processes,quantum,makespan,utilisation,migrations,migration_overhead,"
+                 "mean_turnaround,p99_turnaround,max_turnaround,min_core_busy,max_core_busy,sim_ms\n";
+
+    if (policy == "none" || policy == "all")
+        run_policy("none", workload, config, processes);
+    if (policy == "steal" || policy == "all") {
+        SmpConfig steal = config;
+        steal.work_stealing = true;
+        run_policy("steal", workload, steal, processes);
+    }
+    if (policy == "balance" || policy == "all") {
+        SmpConfig balance = config;
+        balance.balance_interval = balance_interval;
+        run_policy("balance", workload, balance, processes);
+    }
+    if (policy == "both" || policy == "all") {
+        SmpConfig both = config;
+        both.work_stealing = true;
+        both.balance_interval = balance_interval;
+        run_policy("both", workload, both, processes);
+    }
+}
@@ -0,0 +1,238 @@
+#include "smp_scheduler.h"
+#include <deque>
+#include <queue>
+#include <set>
+#include <tuple>
+#include <functional>
+#include "../Common/trace.h"
+
+
+// Event-driven: the only events are arrivals, slice ends and balancing ticks, so time jumps straight
+// from one to the next and idle cores cost nothing. Each core has at most one pending slice end in
+// the heap, and a core running alone gets one slice for its whole remaining burst, which is cut back
+// to the next quantum boundary if another process joins its queue
+class SmpSimulation {
+public:
+    SmpSimulation(const SmpConfig &config, std::vector<Process> &processes, std::vector<std::vector<int>> &seqs,
+                  SmpStats &stats)
+        : config(config), processes(processes), seqs(seqs), stats(stats), cores(config.cores),
+          remaining(processes.size()), migrated(processes.size(), false) {
+        seqs.assign(config.cores, std::vector<int>());
+        stats = SmpStats();
+        stats.busy_time.assign(config.cores, 0);
+        stats.dispatches.assign(config.cores, 0);
+        stats.migrations.assign(config.cores, 0);
+        for (int c = 0; c < config.cores; c++)
+            by_load.emplace(0, c);
+        for (size_t i = 0; i < processes.size(); i++)
+            remaining[i] = processes[i].burst;
+    }
+
+    void run() {
+        const int64_t never = std::numeric_limits<int64_t>::max();
+        size_t next_arrival = 0;
+        int64_t next_balance = never;
+        if (!processes.empty())
+            stats.start_time = stats.end_time = processes[0].arrival_time;
+
+        while (true) {
+            // Drop slice ends that were cut short
+            while (!slice_ends.empty() && std::get<2>(slice_ends.top()) != cores[std::get<1>(slice_ends.top())].generation)
+                slice_ends.pop();
+
+            int64_t t_slice = slice_ends.empty() ? never : std::get<0>(slice_ends.top());
+            int64_t t_arrival = next_arrival < processes.size() ? processes[next_arrival].arrival_time : never;
+            int64_t t_balance = (config.balance_interval > 0 && active > 0) ? next_balance : never;
+            if (t_slice == never && t_arrival == never)
+                break;
+
+            // As in simulate_rr, a process arriving before a slice ends is queued ahead of the
+            // preempted process, one arriving exactly at the end behind it
+            if (t_arrival < t_slice && t_arrival <= t_balance) {
+                int p = next_arrival++;
+                if (active == 0 && config.balance_interval > 0)
+                    next_balance = t_arrival + config.balance_interval;
+                active++;
+                enqueue(place(), p, t_arrival);
+            } else if (t_balance < t_slice) {
+                balance(t_balance);
+                next_balance += config.balance_interval;
+            } else {
+                int c = std::get<1>(slice_ends.top());
+                slice_ends.pop();
+                end_slice(c, t_slice);
+            }
+        }
+
+        for (std::vector<int> &seq : seqs)
+            if (seq.size() > static_cast<size_t>(config.max_seq_len))
+                seq.resize(config.max_seq_len);
+    }
+
+private:
+    struct Core {
+        std::deque<int> run_queue;
+        int running = -1;
+        int load = 0;  // run_queue.size() plus the running process
+        int64_t slice_start = 0;
+        int64_t slice_end = 0;
+        bool idle = true;
+        int64_t idle_since = 0;
+        uint32_t generation = 0;  // bumped whenever the pending slice end is replaced
+    };
+
+    int place() {
+        if (config.placement == Placement::LEAST_LOADED)
+            return by_load.begin()->second;
+        int c = next_core;
+        next_core = (next_core + 1) % config.cores;
+        return c;
+    }
+
+    void set_load(int c, int load) {
+        by_load.erase(std::make_pair(cores[c].load, c));
+        cores[c].load = load;
+        by_load.emplace(load, c);
+    }
+
+    void enqueue(int c, int p, int64_t now) {
+        Core &core = cores[c];
+        core.run_queue.emplace_back(p);
+        set_load(c, core.load + 1);
+
+        if (core.running < 0) {
+            dispatch(c, now);
+        } else if (core.run_queue.size() == 1) {
+            // The running process had the core to itself; it now only gets to the end of its quantum
+            int64_t elapsed = std::max<int64_t>(now - core.slice_start, 0);
+            int64_t boundary = core.slice_start + (elapsed / config.quantum + 1) * config.quantum;
+            if (boundary < core.slice_end)
+                schedule(c, core.slice_start, boundary);
+        }
+    }
+
+    void schedule(int c, int64_t start, int64_t end) {
+        Core &core = cores[c];
+        core.slice_start = start;
+        core.slice_end = end;
+        slice_ends.emplace(end, c, ++core.generation);
+    }
+
+    void dispatch(int c, int64_t now) {
+        Core &core = cores[c];
+        if (core.run_queue.empty() && config.work_stealing)
+            steal(c);
+        if (core.run_queue.empty()) {
+            core.idle = true;
+            core.idle_since = now;
+            return;
+        }
+
+        std::vector<int> &seq = seqs[c];
+        if (core.idle && now > core.idle_since && !seq.empty() && seq.back() != -1 &&
+            seq.size() < static_cast<size_t>(config.max_seq_len))
+            seq.emplace_back(-1);
+        core.idle = false;
+
+        int p = core.run_queue.front();
+        core.run_queue.pop_front();
+        core.running = p;
+        if (processes[p].start_time == -1)
+            processes[p].start_time = now;
+
+        int64_t cost = 0;
+        if (migrated[p]) {
+            cost = config.migration_cost;
+            migrated[p] = false;
+            stats.migration_overhead += cost;
+        }
+
+        int64_t run = core.run_queue.empty() ? remaining[p] : std::min(remaining[p], config.quantum);
+        schedule(c, now + cost, now + cost + run);
+        stats.dispatches[c]++;
+
+        if ((seq.empty() || seq.back() != p) && seq.size() < static_cast<size_t>(config.max_seq_len))
+            seq.emplace_back(p);
+    }
+
+    void end_slice(int c, int64_t now) {
+        Core &core = cores[c];
+        int p = core.running;
+        int64_t ran = core.slice_end - core.slice_start;
+        remaining[p] -= ran;
+        stats.busy_time[c] += ran;
+        core.running = -1;
+
+        if (remaining[p] == 0) {
+            processes[p].finish_time = now;
+            stats.end_time = now;
+            set_load(c, core.load - 1);
+            active--;
+        } else {
+            core.run_queue.emplace_back(p);
+        }
+
+        dispatch(c, now);
+    }
+
+    // Move a waiting process from one core's queue to the back of another's
+    void migrate(int from, int to, int64_t now) {
+        int p = cores[from].run_queue.back();
+        cores[from].run_queue.pop_back();
+        set_load(from, cores[from].load - 1);
+        migrated[p] = true;
+        stats.migrations[to]++;
+        enqueue(to, p, now);
+    }
+
+    // Take the back half of the busiest core's queue: those processes have waited least there, so they
+// lose least by moving
+    void steal(int c) {
+        int victim = by_load.rbegin()->second;
+        size_t waiting = cores[victim].run_queue.size();
+        if (victim == c || waiting == 0)
+            return;
+
+        Core &core = cores[c];
+        for (size_t i = 0; i < (waiting + 1) / 2; i++) {
+            int p = cores[victim].run_queue.back();
+            cores[victim].run_queue.pop_back();
+            set_load(victim, cores[victim].load - 1);
+            migrated[p] = true;
+            stats.migrations[c]++;
+            core.run_queue.emplace_front(p);  // keeps the stolen processes in their original order
+            set_load(c, core.load + 1);
+        }
+    }
+
+    void balance(int64_t now) {
+        while (true) {
+            int low = by_load.begin()->second;
+            int high = by_load.rbegin()->second;
+            if (cores[high].load - cores[low].load <= 1 || cores[high].run_queue.empty())
+                return;
+            migrate(high, low, now);
+        }
+    }
+
+    const SmpConfig &config;
+    std::vector<Process> &processes;
+    std::vector<std::vector<int>> &seqs;
+    SmpStats &stats;
+
+    std::vector<Core> cores;
+    std::set<std::pair<int, int>> by_load;  // (load, core)
+    std::priority_queue<std::tuple<int64_t, int, uint32_t>, std::vector<std::tuple<int64_t, int, uint32_t>>,
+                        std::greater<std::tuple<int64_t, int, uint32_t>>> slice_ends;  // (time, core, generation)
+    std::vector<int64_t> remaining;
+    std::vector<bool> migrated;  // pays migration_cost at its next dispatch
+    size_t active = 0;  // arrived and not finished
+    int next_core = 0;
+};
+
+
+void simulate_smp(const SmpConfig &config, std::vector<Process> &processes, std::vector<std::vector<int>> &seqs,
+                  SmpStats &stats) {
+    TRACE_SCOPE("simulate_smp");
+    SmpSimulation(config, processes, seqs, stats).run();
+}
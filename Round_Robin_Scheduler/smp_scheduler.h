@@ -0,0 +1,50 @@
+#ifndef SMP_SCHEDULER_H
+#define SMP_SCHEDULER_H
+
+#include "scheduler.h"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+
+// Round robin on P cores, each with its own run queue. Processes are placed on a core when they
+// arrive and only move again through the load-balancing policies below
+enum class Placement {
+    ROUND_ROBIN,   // arrivals are dealt to cores in turn
+    LEAST_LOADED   // arrivals go to the core with the fewest runnable processes
+};
+
+struct SmpConfig {
+    int cores = 1;
+    int64_t quantum = 1;
+    int64_t max_seq_len = std::numeric_limits<int64_t>::max();  // per-core limit on seq, as in simulate_rr
+    Placement placement = Placement::LEAST_LOADED;
+    bool work_stealing = false;    // a core that runs dry takes half the queue of the busiest core
+    int64_t balance_interval = 0;  // if > 0, even out queue lengths every balance_interval time units
+    int64_t migration_cost = 0;    // time a migrated process costs its new core before it runs
+};
+
+struct SmpStats {
+    std::vector<int64_t> busy_time;  // per core, time spent running processes
+    std::vector<int64_t> dispatches;  // per core, slices started
+    std::vector<int64_t> migrations;  // per core, processes moved onto it
+    int64_t start_time = 0;  // first arrival
+    int64_t end_time = 0;  // last completion
+    int64_t migration_overhead = 0;  // total time cores spent on migration_cost
+
+    // Fraction of core time spent running processes between the first arrival and the last completion
+    double utilisation() const {
+        int64_t span = (end_time - start_time) * static_cast<int64_t>(busy_time.size());
+        int64_t busy = 0;
+        for (int64_t b : busy_time)
+            busy += b;
+        return span > 0 ? static_cast<double>(busy) / span : 0.0;
+    }
+};
+
+// processes must be sorted by arrival_time, as for simulate_rr. seqs[c] is the execution sequence of
+// core c in simulate_rr's format: consecutive slices of one process are merged and -1 marks idle gaps
+void simulate_smp(const SmpConfig &config, std::vector<Process> &processes, std::vector<std::vector<int>> &seqs,
+                  SmpStats &stats);
+
+#endif
@@ -0,0 +1,167 @@
+#include "workload_store.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../Common/trace.h"
+
+
+// Parse an unsigned decimal at p, advancing it. False if there are no digits
+static bool parse_number(const char *&p, const char *end, int64_t &value) {
+    const char *first = p;
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        value = value * 10 + (*p++ - '0');
+    return p != first;
+}
+
+static void skip_blanks(const char *&p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+}
+
+
+static bool parse_workload(const char *data, size_t size, WorkloadStore &workload) {
+    const char *end = data + size;
+
+    size_t lines = 0;
+    for (const char *p = data; (p = static_cast<const char*>(memchr(p, '\n', end - p))) != nullptr; p++)
+        lines++;
+    if (size > 0 && end[-1] != '\n')
+        lines++;
+    workload.resize(lines);
+
+    int64_t *arrival = workload.arrival();
+    int64_t *burst = workload.burst();
+    size_t n = 0;
+    size_t line = 0;
+
+    for (const char *p = data; p < end; p++) {
+        line++;
+        skip_blanks(p, end);
+        if (p < end && *p == '#')
+            p = std::find(p, end, '\n');
+        if (p == end || *p == '\n')
+            continue;
+
+        int64_t a, b;
+        bool valid = parse_number(p, end, a);
+        skip_blanks(p, end);
+        valid = valid && parse_number(p, end, b);
+        skip_blanks(p, end);
+        if (!valid || (p < end && *p != '\n') || b <= 0 || (n > 0 && a < arrival[n - 1])) {
+            std::cerr << "Bad workload line " << line << std::endl;
+            return false;
+        }
+        arrival[n] = a;
+        burst[n] = b;
+        n++;
+    }
+
+    workload.truncate(n);
+    return true;
+}
+
+
+bool load_workload(const char *path, WorkloadStore &workload) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror(path);
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        workload.resize(0);
+        return true;
+    }
+
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    bool valid = parse_workload(static_cast<const char*>(data), st.st_size, workload);
+    munmap(data, st.st_size);
+    return valid;
+}
+
+
+void simulate_rr(int64_t quantum, int64_t max_seq_len, WorkloadStore &workload, std::vector<int> &seq) {
+    TRACE_SCOPE("simulate_rr");
+    seq.clear();
+
+    size_t n = workload.size();
+    const int64_t *arrival = workload.arrival();
+    int64_t *remaining = workload.remaining();
+    int64_t *start = workload.start();
+    int64_t *finish = workload.finish();
+    int *ready = workload.ready();  // circular; every process is queued at most once
+    std::copy(workload.burst(), workload.burst() + n, remaining);
+    std::fill(start, start + n, -1);
+
+    size_t head = 0, queued = 0, next_arrival = 0, done = 0;
+    int64_t current_time = 0;
+    auto push = [&](int process) {
+        size_t tail = head + queued;
+        ready[tail >= n ? tail - n : tail] = process;
+        queued++;
+    };
+    auto append = [&](int process) {
+        if ((seq.empty() || seq.back() != process) && seq.size() < static_cast<size_t>(max_seq_len))
+            seq.emplace_back(process);
+    };
+
+    while (done < n) {
+        if (queued == 0) {
+            if (arrival[next_arrival] > current_time) {
+                if (!seq.empty())
+                    append(-1);
+                current_time = arrival[next_arrival];
+            }
+            while (next_arrival < n && arrival[next_arrival] <= current_time)
+                push(next_arrival++);
+        }
+
+        int curr_process = ready[head];
+        head = (head + 1 == n) ? 0 : head + 1;
+        queued--;
+        if (start[curr_process] == -1)
+            start[curr_process] = current_time;
+        append(curr_process);
+
+        int64_t update_time = std::min(remaining[curr_process], quantum);
+        if (queued == 0) {
+            // Alone on the CPU: run whole quanta until the quantum in which the next process arrives
+            int64_t limit = remaining[curr_process];
+            if (next_arrival < n)
+                limit = quantum * ((arrival[next_arrival] - current_time) / quantum + 1);
+            update_time = std::min(remaining[curr_process], limit);
+        }
+        remaining[curr_process] -= update_time;
+        current_time += update_time;
+
+        // Add processes that arrived during execution
+        while (next_arrival < n && arrival[next_arrival] < current_time)
+            push(next_arrival++);
+
+        if (remaining[curr_process] > 0) {
+            push(curr_process);
+        } else {
+            finish[curr_process] = current_time;
+            done++;
+        }
+    }
+}
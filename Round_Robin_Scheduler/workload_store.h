@@ -0,0 +1,134 @@
+#ifndef WORKLOAD_STORE_H
+#define WORKLOAD_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+
+const size_t COLUMN_ALIGNMENT = 64;  // a cache line, and a whole AVX-512 register
+
+
+// Workload stored as one array per field instead of a std::vector<Process>. The simulation only
+// touches the columns it needs, and the metric loops below read contiguous, aligned int64 arrays
+// the compiler turns into vector code. The remaining and ready columns are scratch space for
+// simulate_rr, so repeated runs on the same store don't allocate
+class WorkloadStore {
+public:
+    WorkloadStore() = default;
+    WorkloadStore(const WorkloadStore&) = delete;
+    WorkloadStore& operator=(const WorkloadStore&) = delete;
+
+    void resize(size_t n) {
+        count = n;
+        arrival_column = allocate<int64_t>(n);
+        burst_column = allocate<int64_t>(n);
+        start_column = allocate<int64_t>(n);
+        finish_column = allocate<int64_t>(n);
+        remaining_column = allocate<int64_t>(n);
+        ready_column = allocate<int>(n);
+    }
+
+    // Drop rows past n, keeping the columns (used when fewer rows are filled than allocated)
+    void truncate(size_t n) {
+        if (n < count)
+            count = n;
+    }
+
+    size_t size() const { return count; }
+
+    int64_t *arrival() { return arrival_column.get(); }
+    int64_t *burst() { return burst_column.get(); }
+    int64_t *start() { return start_column.get(); }
+    int64_t *finish() { return finish_column.get(); }
+    int64_t *remaining() { return remaining_column.get(); }
+    int *ready() { return ready_column.get(); }
+
+    const int64_t *arrival() const { return arrival_column.get(); }
+    const int64_t *burst() const { return burst_column.get(); }
+    const int64_t *start() const { return start_column.get(); }
+    const int64_t *finish() const { return finish_column.get(); }
+
+private:
+    struct AlignedFree {
+        void operator()(void *p) const { free(p); }
+    };
+
+    template <typename T>
+    static std::unique_ptr<T[], AlignedFree> allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+        void *p = aligned_alloc(COLUMN_ALIGNMENT, bytes == 0 ? COLUMN_ALIGNMENT : bytes);
+        if (p == nullptr)
+            throw std::bad_alloc();
+        return std::unique_ptr<T[], AlignedFree>(static_cast<T*>(p));
+    }
+
+    size_t count = 0;
+    std::unique_ptr<int64_t[], AlignedFree> arrival_column;
+    std::unique_ptr<int64_t[], AlignedFree> burst_column;
+    std::unique_ptr<int64_t[], AlignedFree> start_column;
+    std::unique_ptr<int64_t[], AlignedFree> finish_column;
+    std::unique_ptr<int64_t[], AlignedFree> remaining_column;
+    std::unique_ptr<int[], AlignedFree> ready_column;  // circular ready queue
+};
+
+
+struct WorkloadMetrics {
+    double mean_turnaround = 0;  // finish - arrival
+    double mean_waiting = 0;  // turnaround - burst
+    double mean_response = 0;  // start - arrival
+    int64_t max_turnaround = 0;
+    int64_t max_waiting = 0;
+    int64_t max_response = 0;
+};
+
+// One pass over four columns. Branch-free sums and maxes over aligned arrays, which GCC and Clang
+// vectorize at -O3 (-O2 on GCC 12+); nothing here depends on a particular instruction set
+inline WorkloadMetrics compute_metrics(const WorkloadStore &workload) {
+    const int64_t *arrival = static_cast<const int64_t*>(__builtin_assume_aligned(workload.arrival(), COLUMN_ALIGNMENT));
+    const int64_t *burst = static_cast<const int64_t*>(__builtin_assume_aligned(workload.burst(), COLUMN_ALIGNMENT));
+    const int64_t *start = static_cast<const int64_t*>(__builtin_assume_aligned(workload.start(), COLUMN_ALIGNMENT));
+    const int64_t *finish = static_cast<const int64_t*>(__builtin_assume_aligned(workload.finish(), COLUMN_ALIGNMENT));
+    size_t n = workload.size();
+
+    int64_t turnaround_sum = 0, waiting_sum = 0, response_sum = 0;
+    int64_t turnaround_max = 0, waiting_max = 0, response_max = 0;
+    for (size_t i = 0; i < n; i++) {
+        int64_t turnaround = finish[i] - arrival[i];
+        int64_t waiting = turnaround - burst[i];
+        int64_t response = start[i] - arrival[i];
+        turnaround_sum += turnaround;
+        waiting_sum += waiting;
+        response_sum += response;
+        turnaround_max = turnaround > turnaround_max ? turnaround : turnaround_max;
+        waiting_max = waiting > waiting_max ? waiting : waiting_max;
+        response_max = response > response_max ? response : response_max;
+    }
+
+    WorkloadMetrics metrics;
+    if (n > 0) {
+        metrics.mean_turnaround = static_cast<double>(turnaround_sum) / n;
+        metrics.mean_waiting = static_cast<double>(waiting_sum) / n;
+        metrics.mean_response = static_cast<double>(response_sum) / n;
+    }
+    metrics.max_turnaround = turnaround_max;
+    metrics.max_waiting = waiting_max;
+    metrics.max_response = response_max;
+    return metrics;
+}
+
+
+// Load an arrival-sorted workload file, one "arrival_time burst" pair per line; blank lines and lines
+// starting with '#' are skipped. The file is mapped and parsed in place: one pass counts the lines
+// so every column is allocated once, a second parses straight into the columns. Returns false if the
+// file can't be read, a line is malformed or arrivals go backwards
+bool load_workload(const char *path, WorkloadStore &workload);
+
+// simulate_rr on a WorkloadStore, with the same scheduling order: a process arriving before a slice
+// ends is queued ahead of the preempted process. Fills the start and finish columns
+void simulate_rr(int64_t quantum, int64_t max_seq_len, WorkloadStore &workload, std::vector<int> &seq);
+
+#endif